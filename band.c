@@ -31,6 +31,7 @@
 #include "radio.h"
 #include "vfo.h"
 #include "message.h"
+#include "snapshot.h"
 
 int xvtr_band = BANDS;
 
@@ -535,9 +536,90 @@ void radio_change_region(int r) {
     bandstack60.entry = bandstack_entries60_CA;
     break;
   }
+
+  band_index_rebuild();
+}
+
+//
+// Binary snapshot of the bands and band stacks. The sections mirror
+// what is saved as text props: the per-band settings, the band edges
+// for bands > 11, the transverter data, and for each band the current
+// bandstack entry and the bandstack entries themselves.
+//
+static const SNAP_FIELD band_fields[] = {
+  SNAP_VAL(BAND, disablePA),
+  SNAP_VAL(BAND, alexRxAntenna),
+  SNAP_VAL(BAND, alexTxAntenna),
+  SNAP_VAL(BAND, alexAttenuation),
+  SNAP_VAL(BAND, pa_calibration),
+  SNAP_VAL(BAND, OCrx),
+  SNAP_VAL(BAND, OCtx)
+};
+
+static const SNAP_FIELD band_edge_fields[] = {
+  SNAP_VAL(BAND, frequencyMin),
+  SNAP_VAL(BAND, frequencyMax)
+};
+
+static const SNAP_FIELD xvtr_fields[] = {
+  SNAP_STR(BAND, title),
+  SNAP_VAL(BAND, frequencyLO),
+  SNAP_VAL(BAND, errorLO),
+  SNAP_VAL(BAND, gain)
+};
+
+static const SNAP_FIELD current_fields[] = {
+  SNAP_VAL(BANDSTACK, current_entry)
+};
+
+static const SNAP_FIELD stack_fields[] = {
+  SNAP_VAL(BANDSTACK_ENTRY, frequency),
+  SNAP_VAL(BANDSTACK_ENTRY, mode),
+  SNAP_VAL(BANDSTACK_ENTRY, filter),
+  SNAP_VAL(BANDSTACK_ENTRY, ctun),
+  SNAP_VAL(BANDSTACK_ENTRY, ctun_frequency),
+  SNAP_VAL(BANDSTACK_ENTRY, deviation),
+  SNAP_VAL(BANDSTACK_ENTRY, ctcss_enabled),
+  SNAP_VAL(BANDSTACK_ENTRY, ctcss)
+};
+
+#define BAND_SNAP_SECTIONS (3 + 2 * (BANDS + XVTRS))
+
+static int band_snapshot_sections(SNAP_SECTION *sec) {
+  SNAP_SECTION *s = sec;
+  *s++ = (SNAP_SECTION) {
+    "band", band_fields, SNAP_NFIELDS(band_fields), (char *) bands, sizeof(BAND), BANDS + XVTRS
+  };
+  *s++ = (SNAP_SECTION) {
+    "band.edges", band_edge_fields, SNAP_NFIELDS(band_edge_fields), (char *) &bands[12], sizeof(BAND), BANDS + XVTRS - 12
+  };
+  *s++ = (SNAP_SECTION) {
+    "xvtr", xvtr_fields, SNAP_NFIELDS(xvtr_fields), (char *) &bands[BANDS], sizeof(BAND), XVTRS
+  };
+
+  for (int b = 0; b < BANDS + XVTRS; b++) {
+    BANDSTACK *bandstack = bands[b].bandstack;
+    *s = (SNAP_SECTION) {
+      "", current_fields, SNAP_NFIELDS(current_fields), (char *) bandstack, sizeof(BANDSTACK), 1
+    };
+    snprintf(s->name, sizeof(s->name), "band.%d.current", b);
+    s++;
+    *s = (SNAP_SECTION) {
+      "", stack_fields, SNAP_NFIELDS(stack_fields), (char *) bandstack->entry, sizeof(BANDSTACK_ENTRY), bandstack->entries
+    };
+    snprintf(s->name, sizeof(s->name), "band.%d.stack", b);
+    s++;
+  }
+
+  return BAND_SNAP_SECTIONS;
 }
 
 void bandSaveState(void) {
+  SNAP_SECTION sec[BAND_SNAP_SECTIONS];
+  band_snapshot_sections(sec);
+
+  if (!snapshot_save("band", sec, BAND_SNAP_SECTIONS)) { return; }
+
   for (int b = 0; b < BANDS + XVTRS; b++) {
     //
     // Skip non-assigned transverter bands
@@ -581,7 +663,7 @@ void bandSaveState(void) {
   }
 }
 
-void bandRestoreState(void) {
+static void bandRestoreProps(void) {
   for (int b = 0; b < BANDS + XVTRS; b++) {
     //
     // For the "normal" (non-XVTR) bands, do not change the title,
@@ -623,6 +705,17 @@ void bandRestoreState(void) {
       GetPropI2("band.%d.stack.%d.ctcss", b, stack,          entry->ctcss);
     }
   }
+}
+
+void bandRestoreState(void) {
+  SNAP_SECTION sec[BAND_SNAP_SECTIONS];
+  band_snapshot_sections(sec);
+
+  if (snapshot_restore("band", sec, BAND_SNAP_SECTIONS)) {
+    bandRestoreProps();
+  }
+
+  snapshot_register("band", band_snapshot_sections);
 
   for (int b = 0; b < BANDS + XVTRS; b++) {
     //
@@ -644,44 +737,191 @@ void bandRestoreState(void) {
       bands[b].pa_calibration = 70.0;
     }
   }
+
+  band_index_rebuild();
 }
 
-int get_band_from_frequency(long long f) {
-  int b;
-  int found = -1;
+//
+// Interval index for get_band_from_frequency()
+//
+// The frequency axis is cut into segments at all band edges. For each
+// segment, the band that a linear scan over the bands would find first
+// is stored, so a lookup is a binary search over the segment starts.
+// There is one index for the regular bands, one for the XVTR bands
+// (which take precedence), and one for the WWV frequencies.
+//
+// The index must be rebuilt (band_index_rebuild) whenever band edges
+// or XVTR bands change. It is first built from the built-in band table
+// by band_init() at program start, and re-built (by the GTK thread)
+// when the band data is restored, when the region changes, and when
+// the XVTR bands have been edited (vfo_xvtr_changed). Whoever changes
+// frequencyMin, frequencyMax or the title of a band must rebuild it.
+// Lookups never build the index.
+//
+// Readers on other threads (HighPrio packet building) may call
+// get_band_from_frequency() at any time, so the published index is
+// protected by a sequence lock as in vfo_snapshot(): band_index_seq is
+// odd while a rebuild copies the new index in place, and a lookup is
+// repeated if band_index_seq was odd or has changed meanwhile. The new
+// index is built in a scratch copy first, so the odd phase is short.
+// Before the first rebuild the index is empty, and every frequency
+// maps to bandGen, but band_init() makes sure this never happens.
+//
+#define BAND_INDEX_MAX (2 * (BANDS + XVTRS) + 1)
+
+typedef struct _band_index {
+  int       n;                        // number of segment starts
+  long long start[BAND_INDEX_MAX];    // segment i is start[i] ... start[i+1]-1
+  int       band[BAND_INDEX_MAX];     // band of segment i, -1 if none
+} BAND_INDEX;
+
+typedef struct _band_index_set {
+  BAND_INDEX regular;
+  BAND_INDEX xvtr;
+  BAND_INDEX wwv;
+} BAND_INDEX_SET;
+
+static BAND_INDEX_SET band_index;
+static BAND_INDEX_SET band_index_scratch;    // GTK thread only
+static unsigned int band_index_seq = 0;
+
+static int band_index_cmp(const void *a, const void *b) {
+  long long x = *(const long long *)a;
+  long long y = *(const long long *)b;
+  return (x > y) - (x < y);
+}
 
-  //
-  // do not search non-xvtr bands if frequency not supported
-  // by the radio
-  //
-  if (f >= radio->frequency_min && f <= radio->frequency_max) {
-    for (b = 0; b < BANDS; b++) {
-      const BAND *band = band_get_band(b);
+//
+// Build an index from intervals given in order of precedence
+//
+static void band_index_build(BAND_INDEX *idx, const long long *lo, const long long *hi, const int *val, int k) {
+  int n = 0;
 
-      if (strlen(band->title) > 0) {
-        if (f >= band->frequencyMin && f <= band->frequencyMax) {
-          found = b;
-          break;
-        }
+  for (int i = 0; i < k; i++) {
+    idx->start[n++] = lo[i];
+    idx->start[n++] = hi[i] + 1;
+  }
+
+  qsort(idx->start, n, sizeof(long long), band_index_cmp);
+  idx->n = 0;
+
+  for (int i = 0; i < n; i++) {
+    if (idx->n > 0 && idx->start[idx->n - 1] == idx->start[i]) { continue; }
+
+    idx->start[idx->n++] = idx->start[i];
+  }
+
+  for (int s = 0; s < idx->n; s++) {
+    idx->band[s] = -1;
+
+    for (int i = 0; i < k; i++) {
+      if (idx->start[s] >= lo[i] && idx->start[s] <= hi[i]) {
+        idx->band[s] = val[i];
+        break;
       }
     }
   }
+}
+
+static int band_index_lookup(const BAND_INDEX *idx, long long f) {
+  int n = idx->n;
+  int l = 0;
+  int r;
 
   //
-  // start a new search on the xvtr bands such that if an xvtr
-  // band produces a match, it will take precedence
+  // A lookup racing with a rebuild may see a torn index; its result is
+  // discarded, but it must not go out of bounds.
   //
-  for (b = BANDS; b < BANDS + XVTRS; b++) {
+  if (n > BAND_INDEX_MAX) { n = BAND_INDEX_MAX; }
+
+  r = n - 1;
+
+  if (n <= 0 || f < idx->start[0]) { return -1; }
+
+  //
+  // find the last segment start <= f
+  //
+  while (l < r) {
+    int m = (l + r + 1) / 2;
+
+    if (idx->start[m] <= f) {
+      l = m;
+    } else {
+      r = m - 1;
+    }
+  }
+
+  return idx->band[l];
+}
+
+void band_index_rebuild(void) {
+  static const long long wwv[6] = { 2500000LL, 5000000LL, 10000000LL, 15000000LL, 20000000LL, 25000000LL };
+  BAND_INDEX_SET *set = &band_index_scratch;
+  unsigned int seq;
+  long long lo[BANDS + XVTRS];
+  long long hi[BANDS + XVTRS];
+  int val[BANDS + XVTRS];
+  int k;
+  k = 0;
+
+  for (int b = 0; b < BANDS; b++) {
     const BAND *band = band_get_band(b);
 
-    if (strlen(band->title) > 0) {
-      if (f >= band->frequencyMin && f <= band->frequencyMax) {
-        found = b;
-        break;
-      }
+    if (band->title[0]) {
+      lo[k] = band->frequencyMin;
+      hi[k] = band->frequencyMax;
+      val[k++] = b;
     }
   }
 
+  band_index_build(&set->regular, lo, hi, val, k);
+  k = 0;
+
+  for (int b = BANDS; b < BANDS + XVTRS; b++) {
+    const BAND *band = band_get_band(b);
+
+    if (band->title[0]) {
+      lo[k] = band->frequencyMin;
+      hi[k] = band->frequencyMax;
+      val[k++] = b;
+    }
+  }
+
+  band_index_build(&set->xvtr, lo, hi, val, k);
+
+  for (k = 0; k < 6; k++) {
+    lo[k] = wwv[k] - 1000;
+    hi[k] = wwv[k] + 1000;
+    val[k] = bandWWV;
+  }
+
+  band_index_build(&set->wwv, lo, hi, val, 6);
+  seq = __atomic_load_n(&band_index_seq, __ATOMIC_RELAXED);
+  __atomic_store_n(&band_index_seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(&band_index, set, sizeof(band_index));
+  __atomic_store_n(&band_index_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void band_init(void) {
+  band_index_rebuild();
+}
+
+static int band_index_find(const BAND_INDEX_SET *idx, long long f) {
+  int found;
+  //
+  // an xvtr band that produces a match takes precedence
+  //
+  found = band_index_lookup(&idx->xvtr, f);
+
+  //
+  // do not search non-xvtr bands if frequency not supported
+  // by the radio
+  //
+  if (found < 0 && f >= radio->frequency_min && f <= radio->frequency_max) {
+    found = band_index_lookup(&idx->regular, f);
+  }
+
   //
   // If no band has been found:
   //  - use bandWWV if the frequency is (close to) 2.5, 5.0, 10.0, 15.0, 20.0, or 25.0 MHz
@@ -692,22 +932,29 @@ int get_band_from_frequency(long long f) {
   //    if the radio does not support frequencies > 30 MHz.
   //
   if (found < 0) {
-    found = bandGen;
+    found = band_index_lookup(&idx->wwv, f);
+
+    if (found < 0) { found = bandGen; }
+  }
 
-    if (llabs(f -  2500000LL) <= 1000) { found = bandWWV; }
+  return found;
+}
 
-    if (llabs(f -  5000000LL) <= 1000) { found = bandWWV; }
+int get_band_from_frequency(long long f) {
+  unsigned int seq1, seq2;
+  int found;
 
-    if (llabs(f - 10000000LL) <= 1000) { found = bandWWV; }
+  for (;;) {
+    seq1 = __atomic_load_n(&band_index_seq, __ATOMIC_ACQUIRE);
 
-    if (llabs(f - 15000000LL) <= 1000) { found = bandWWV; }
+    if (seq1 & 1) { continue; }
 
-    if (llabs(f - 20000000LL) <= 1000) { found = bandWWV; }
+    found = band_index_find(&band_index, f);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    seq2 = __atomic_load_n(&band_index_seq, __ATOMIC_RELAXED);
 
-    if (llabs(f - 25000000LL) <= 1000) { found = bandWWV; }
+    if (seq1 == seq2) { return found; }
   }
-
-  return found;
 }
 
 #if 0
@@ -0,0 +1,164 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Block diversity combiner
+//
+// divcomb_process() works on whole frames: the correlations needed for
+// the adaptive modes are summed over the frame, the weight is updated
+// once per frame, and the combining loop itself is a plain loop over
+// arrays that the compiler can vectorize. To avoid clicks, the weight
+// is ramped linearly from its old to its new value across the frame.
+//
+// divcomb_process() is only called from the IQ worker that processes
+// the diversity DDC, so the estimator state needs no locking. The mode
+// is set from the GTK thread, and a mode change resets the estimator.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+
+#include "divcombiner.h"
+#include "radio.h"
+
+#define DIV_MAX_WEIGHT 10.0           // limit |w| if ADC0 (MAXSNR) or ADC1 (NULL) has (almost) no signal
+
+int div_adapt_time = 100;
+
+static int div_mode = DIV_ADAPT_OFF;
+static int div_reset = 1;
+
+//
+// Estimator state (IQ worker only)
+//
+static double r01_re, r01_im;         // <x0 conj(x1)>
+static double r00;                    // <|x0|^2>
+static double r11;                    // <|x1|^2>
+static double w_re, w_im;             // weight used at the end of the last frame
+
+//
+// Weight for the GTK thread
+//
+static double div_weight_re = 0.0, div_weight_im = 0.0;
+
+void divcomb_set_mode(int mode) {
+  __atomic_store_n(&div_mode, mode, __ATOMIC_RELEASE);
+  __atomic_store_n(&div_reset, 1, __ATOMIC_RELEASE);
+}
+
+int divcomb_get_mode(void) {
+  return __atomic_load_n(&div_mode, __ATOMIC_ACQUIRE);
+}
+
+void divcomb_get_weight(double *gain, double *phase) {
+  //
+  // Current weight as gain (dB) and phase (degrees), e.g. to be shown
+  // in the diversity menu while in an adaptive mode
+  //
+  double re, im, mag;
+  __atomic_load(&div_weight_re, &re, __ATOMIC_ACQUIRE);
+  __atomic_load(&div_weight_im, &im, __ATOMIC_ACQUIRE);
+  mag = hypot(re, im);
+  *gain = (mag > 1.0E-10) ? 20.0 * log10(mag) : -200.0;
+  *phase = atan2(im, re) * 57.295779513082320876798154814105;
+}
+
+void divcomb_process(const double *restrict iq0, const double *restrict iq1, double *restrict out, int n,
+                     int sample_rate) {
+  int mode = __atomic_load_n(&div_mode, __ATOMIC_ACQUIRE);
+  double new_re, new_im;
+
+  if (n <= 0) { return; }
+
+  if (__atomic_exchange_n(&div_reset, 0, __ATOMIC_ACQ_REL)) {
+    r01_re = r01_im = r00 = r11 = 0.0;
+    w_re = div_cos;
+    w_im = div_sin;
+  }
+
+  if (mode == DIV_ADAPT_OFF) {
+    new_re = div_cos;
+    new_im = div_sin;
+  } else {
+    double s01_re = 0.0, s01_im = 0.0, s00 = 0.0, s11 = 0.0;
+    double alpha, norm;
+
+    for (int i = 0; i < n; i++) {
+      double i0 = iq0[2 * i], q0 = iq0[2 * i + 1];
+      double i1 = iq1[2 * i], q1 = iq1[2 * i + 1];
+      s01_re += i0 * i1 + q0 * q1;
+      s01_im += q0 * i1 - i0 * q1;
+      s00    += i0 * i0 + q0 * q0;
+      s11    += i1 * i1 + q1 * q1;
+    }
+
+    //
+    // Exponential averaging of the per-sample correlations, with the
+    // time constant div_adapt_time
+    //
+    alpha = 1.0 - exp(-(double)n / (0.001 * (double)div_adapt_time * (double)sample_rate));
+    r01_re += alpha * (s01_re / n - r01_re);
+    r01_im += alpha * (s01_im / n - r01_im);
+    r00    += alpha * (s00 / n - r00);
+    r11    += alpha * (s11 / n - r11);
+
+    //
+    // MAXSNR: w = R01/R00, NULL: w = -R01/R11 (see divcombiner.h)
+    //
+    norm = (mode == DIV_ADAPT_NULL) ? r11 : r00;
+
+    if (norm > 1.0E-20) {
+      new_re = r01_re / norm;
+      new_im = r01_im / norm;
+    } else {
+      new_re = new_im = 0.0;
+    }
+
+    double mag = hypot(new_re, new_im);
+
+    if (mag > DIV_MAX_WEIGHT) {
+      new_re *= DIV_MAX_WEIGHT / mag;
+      new_im *= DIV_MAX_WEIGHT / mag;
+    }
+
+    if (mode == DIV_ADAPT_NULL) {
+      new_re = -new_re;
+      new_im = -new_im;
+    }
+  }
+
+  //
+  // Combine, ramping the weight from (w_re, w_im) to (new_re, new_im)
+  //
+  double d_re = (new_re - w_re) / n;
+  double d_im = (new_im - w_im) / n;
+
+  for (int i = 0; i < n; i++) {
+    double c = w_re + (i + 1) * d_re;
+    double s = w_im + (i + 1) * d_im;
+    double i1 = iq1[2 * i], q1 = iq1[2 * i + 1];
+    out[2 * i]     = iq0[2 * i]     + (c * i1 - s * q1);
+    out[2 * i + 1] = iq0[2 * i + 1] + (s * i1 + c * q1);
+  }
+
+  w_re = new_re;
+  w_im = new_im;
+  __atomic_store(&div_weight_re, &w_re, __ATOMIC_RELEASE);
+  __atomic_store(&div_weight_im, &w_im, __ATOMIC_RELEASE);
+}
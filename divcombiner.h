@@ -0,0 +1,54 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _DIVCOMBINER_H_
+#define _DIVCOMBINER_H_
+
+//
+// Block diversity combiner.
+//
+// The combined signal is x0 + w * x1, where x0 and x1 are the (complex)
+// samples from ADC0 and ADC1. In manual mode, the weight w is taken from
+// div_cos/div_sin (set from the diversity gain and phase). In the adaptive
+// modes, w is estimated continuously from the correlation of x0 and x1:
+//
+// DIV_ADAPT_MAXSNR: w = R01/R00. If x1 = h * x0 (plus noise), this is
+//                   about conj(h), so ADC1 adds coherently to ADC0 and
+//                   is weighted by its relative signal level (maximum
+//                   ratio combining)
+// DIV_ADAPT_NULL:   w = -R01/R11, that is, whatever in ADC0 is
+//                   correlated with ADC1 (the noise antenna) is cancelled
+//
+// with R01 = <x0 conj(x1)>, R00 = <|x0|^2> and R11 = <|x1|^2>, averaged
+// with a time constant of div_adapt_time msec.
+//
+
+enum _div_adapt_mode {
+  DIV_ADAPT_OFF = 0,
+  DIV_ADAPT_MAXSNR,
+  DIV_ADAPT_NULL
+};
+
+extern int div_adapt_time;
+
+extern void divcomb_set_mode(int mode);
+extern int  divcomb_get_mode(void);
+extern void divcomb_get_weight(double *gain, double *phase);
+extern void divcomb_process(const double *iq0, const double *iq1, double *out, int n, int sample_rate);
+
+#endif
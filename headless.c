@@ -0,0 +1,473 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Headless mode
+//
+// Instead of building the GTK application, a plain GLib main loop is run.
+// This keeps all the g_idle_add() and g_timeout_add() calls in the
+// protocol and radio code working (they are executed in the thread
+// that runs the main loop, just as in the GUI case), but nothing is
+// ever drawn.
+//
+// Start-up sequence:
+// - secure the FFTW wisdom file and run the discovery, each in its own
+//   thread, while the audio devices are enumerated in the main thread
+// - when all three are complete, pick the radio (the first available
+//   one, or the one specified with -a)
+// - start the radio with radio_start_headless(). This is start_radio()
+//   without any widgets: it restores the props, creates the receivers
+//   and the transmitter (WDSP channels only, no panadapters, no VFO
+//   bar, no menus) and starts the protocol. gtk_init() is never called,
+//   so nothing in this path may create a widget.
+// - open the command socket
+//
+// The command socket only accepts connections from localhost. Each
+// command is one line, the answer is one line starting with "OK" or "ERR".
+//
+// status               report radio, frequencies, mode, band and mox
+// freq <hz>            set frequency of VFO A (must be within the range
+//                      of the radio, or of a transverter band)
+// freqb <hz>           set frequency of VFO B
+// mode <n>             set mode of the active receiver
+// band <n>             set band of the active receiver
+// mox <0|1>            switch TX on/off (if the radio can transmit)
+// stop                 stop the protocol
+// start                (re-)start the protocol
+// save                 save the props file
+// scan <start> <stop> <step>
+//                      scan VFO A from start to stop (Hz)
+// scan band            scan the bandstack entries of VFO A
+// scan stop            stop scanning
+// spectrum <hz> [<rate>]
+//                      start a spectrum-only receiver (ADC0, default 48000)
+// spectrum peak <id>   report frequency and level (dBFS) of the strongest signal
+// spectrum stop <id>   remove a spectrum-only receiver
+// div <0|1|2>          diversity weights: manual, adaptive max. SNR,
+//                      adaptive nulling. Reports the current weight.
+// quit                 save state, stop the radio and exit
+//
+// If compiled with P2TRACE:
+//
+// trace <0|1>          switch event tracing off/on
+// tracedump            write the trace to p2trace.json
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <gtk/gtk.h>
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <wdsp.h>
+
+#include "headless.h"
+#include "audio.h"
+#include "band.h"
+#include "discovered.h"
+#include "divcombiner.h"
+#include "new_discovery.h"
+#include "old_discovery.h"
+#include "main.h"
+#include "message.h"
+#include "mode.h"
+#include "p2capture.h"
+#include "p2trace.h"
+#include "radio.h"
+#include "scanner.h"
+#include "receiver.h"
+#include "spectrum_rx.h"
+#include "vfo.h"
+#include "wisdomcache.h"
+
+int headless = 0;
+
+static GMainLoop *headless_loop = NULL;
+static int cmd_socket = -1;
+static GIOChannel *cmd_channel = NULL;
+static guint cmd_watch = 0;
+
+static void headless_reply(GIOChannel *channel, const char *fmt, ...) {
+  char line[512];
+  va_list args;
+  gsize written;
+  va_start(args, fmt);
+  vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+  g_io_channel_write_chars(channel, line, -1, &written, NULL);
+  g_io_channel_flush(channel, NULL);
+}
+
+//
+// Accept a frequency the same way the frequency entry menu does: it must
+// be within the range of the radio, for a transverter band after
+// subtracting the LO frequency.
+//
+static int headless_frequency_ok(long long f) {
+  int b = get_band_from_frequency(f);
+
+  if (b >= BANDS) {
+    const BAND *band = band_get_band(b);
+    f -= band->frequencyLO + band->errorLO;
+  }
+
+  return f >= radio->frequency_min && f <= radio->frequency_max;
+}
+
+static void headless_command(GIOChannel *channel, char *line) {
+  char cmd[32];
+  long long arg = 0;
+  int n;
+
+  if (radio == NULL) {
+    headless_reply(channel, "ERR no radio\n");
+    return;
+  }
+
+  n = sscanf(line, "%31s %lld", cmd, &arg);
+
+  if (n < 1) {
+    return;
+  }
+
+  if (!strcmp(cmd, "status")) {
+    headless_reply(channel, "OK name=%s protocol=%d device=%d freqa=%lld freqb=%lld mode=%d band=%d mox=%d\n",
+                   radio->name, radio->protocol, radio->device,
+                   vfo[VFO_A].frequency, vfo[VFO_B].frequency,
+                   vfo[active_receiver->id].mode, vfo[active_receiver->id].band,
+                   radio_is_transmitting());
+  } else if ((!strcmp(cmd, "freq") || !strcmp(cmd, "freqb")) && n == 2) {
+    if (headless_frequency_ok(arg)) {
+      vfo_set_frequency(cmd[4] ? VFO_B : VFO_A, arg);
+      headless_reply(channel, "OK\n");
+    } else {
+      headless_reply(channel, "ERR frequency %lld out of range\n", arg);
+    }
+  } else if (!strcmp(cmd, "mode") && n == 2 && arg >= 0 && arg < MODES) {
+    vfo_mode_changed((int) arg);
+    headless_reply(channel, "OK\n");
+  } else if (!strcmp(cmd, "band") && n == 2 && arg >= 0 && arg < BANDS + XVTRS) {
+    vfo_band_changed(active_receiver->id, (int) arg);
+    headless_reply(channel, "OK\n");
+  } else if (!strcmp(cmd, "mox") && n == 2) {
+    if (arg && !can_transmit) {
+      headless_reply(channel, "ERR radio cannot transmit\n");
+    } else {
+      radio_set_mox(arg != 0);
+      headless_reply(channel, "OK\n");
+    }
+  } else if (!strcmp(cmd, "stop")) {
+    radio_protocol_stop();
+    headless_reply(channel, "OK\n");
+  } else if (!strcmp(cmd, "start")) {
+    radio_protocol_run();
+    headless_reply(channel, "OK\n");
+  } else if (!strcmp(cmd, "save")) {
+    radio_save_state();
+    headless_reply(channel, "OK\n");
+  } else if (!strcmp(cmd, "scan")) {
+    long long start, stop, step;
+    int rc;
+
+    if (strstr(line, "stop")) {
+      scanner_stop();
+      rc = 0;
+    } else if (strstr(line, "band")) {
+      rc = scanner_start_bandstack(VFO_A);
+    } else if (sscanf(line, "%*s %lld %lld %lld", &start, &stop, &step) == 3) {
+      rc = scanner_start_range(VFO_A, start, stop, step);
+    } else {
+      rc = -1;
+    }
+
+    headless_reply(channel, rc == 0 ? "OK\n" : "ERR scan\n");
+  } else if (!strcmp(cmd, "div")) {
+    double gain, phase;
+
+    if (n == 2 && arg >= DIV_ADAPT_OFF && arg <= DIV_ADAPT_NULL) { divcomb_set_mode((int) arg); }
+
+    divcomb_get_weight(&gain, &phase);
+    headless_reply(channel, "OK mode=%d gain=%.1f phase=%.1f\n", divcomb_get_mode(), gain, phase);
+  } else if (!strcmp(cmd, "spectrum")) {
+    long long freq;
+    int id, rate = 48000;
+    SPECTRUM_RX *srx;
+
+    if (sscanf(line, "%*s stop %d", &id) == 1) {
+      if (id >= 0 && id < MAX_SPECTRUM_RX && spectrum_rx[id] != NULL) {
+        spectrum_rx_destroy(spectrum_rx[id]);
+        headless_reply(channel, "OK\n");
+      } else {
+        headless_reply(channel, "ERR no spectrum receiver %d\n", id);
+      }
+    } else if (sscanf(line, "%*s peak %d", &id) == 1) {
+      if (id >= 0 && id < MAX_SPECTRUM_RX && spectrum_rx[id] != NULL) {
+        double dbfs;
+        spectrum_rx_peak(spectrum_rx[id], &freq, &dbfs);
+        headless_reply(channel, "OK freq=%lld dbfs=%.1f\n", freq, dbfs);
+      } else {
+        headless_reply(channel, "ERR no spectrum receiver %d\n", id);
+      }
+    } else if (sscanf(line, "%*s %lld %d", &freq, &rate) >= 1
+               && (srx = spectrum_rx_create(0, rate, freq, 1024, 10)) != NULL) {
+      headless_reply(channel, "OK %d\n", srx->id);
+    } else {
+      headless_reply(channel, "ERR spectrum\n");
+    }
+#ifdef P2TRACE
+  } else if (!strcmp(cmd, "trace") && n == 2) {
+    p2trace_enable(arg != 0);
+    headless_reply(channel, "OK\n");
+  } else if (!strcmp(cmd, "tracedump")) {
+    if (p2trace_dump("p2trace.json") == 0) {
+      headless_reply(channel, "OK\n");
+    } else {
+      headless_reply(channel, "ERR cannot write p2trace.json\n");
+    }
+
+#endif
+  } else if (!strcmp(cmd, "quit")) {
+    headless_reply(channel, "OK\n");
+    g_main_loop_quit(headless_loop);
+  } else {
+    headless_reply(channel, "ERR unknown command: %s\n", cmd);
+  }
+}
+
+static gboolean headless_client_cb(GIOChannel *channel, GIOCondition condition, gpointer data) {
+  gchar *line = NULL;
+  gsize len;
+  GIOStatus status = G_IO_STATUS_AGAIN;
+
+  //
+  // The channel is non-blocking. Handle all complete lines that have
+  // arrived (a client may send several commands at once), and keep an
+  // incomplete line in the channel buffer until the rest arrives.
+  //
+  if (condition & G_IO_IN) {
+    while ((status = g_io_channel_read_line(channel, &line, &len, NULL, NULL)) == G_IO_STATUS_NORMAL) {
+      if (line) {
+        g_strstrip(line);
+        headless_command(channel, line);
+        g_free(line);
+        line = NULL;
+      }
+    }
+
+    g_free(line);
+  }
+
+  if (status == G_IO_STATUS_EOF || status == G_IO_STATUS_ERROR || (condition & (G_IO_HUP | G_IO_ERR))) {
+    g_io_channel_shutdown(channel, FALSE, NULL);
+    g_io_channel_unref(channel);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean headless_accept_cb(GIOChannel *source, GIOCondition condition, gpointer data) {
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof(addr);
+  int fd = accept(cmd_socket, (struct sockaddr *)&addr, &addrlen);
+
+  if (fd < 0) {
+    t_perror("headless accept:");
+    return TRUE;
+  }
+
+  t_print("%s: connection from %s\n", __func__, inet_ntoa(addr.sin_addr));
+  GIOChannel *channel = g_io_channel_unix_new(fd);
+  g_io_channel_set_close_on_unref(channel, TRUE);
+  g_io_channel_set_encoding(channel, NULL, NULL);
+  g_io_channel_set_flags(channel, g_io_channel_get_flags(channel) | G_IO_FLAG_NONBLOCK, NULL);
+  g_io_add_watch(channel, G_IO_IN | G_IO_HUP | G_IO_ERR, headless_client_cb, NULL);
+  return TRUE;
+}
+
+static int headless_open_socket(int port) {
+  struct sockaddr_in addr;
+  int optval = 1;
+  cmd_socket = socket(AF_INET, SOCK_STREAM, 0);
+
+  if (cmd_socket < 0) {
+    t_perror("headless socket:");
+    return -1;
+  }
+
+  setsockopt(cmd_socket, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+
+  if (bind(cmd_socket, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(cmd_socket, 4) < 0) {
+    t_perror("headless bind/listen:");
+    close(cmd_socket);
+    cmd_socket = -1;
+    return -1;
+  }
+
+  cmd_channel = g_io_channel_unix_new(cmd_socket);
+  g_io_channel_set_close_on_unref(cmd_channel, TRUE);
+  cmd_watch = g_io_add_watch(cmd_channel, G_IO_IN, headless_accept_cb, NULL);
+  t_print("%s: command socket on port %d\n", __func__, port);
+  return 0;
+}
+
+//
+// Start-up stages. Each stage reports its completion in the main
+// thread by clearing its bit in startup_pending.
+//
+enum {
+  STARTUP_AUDIO     = 1,
+  STARTUP_WISDOM    = 2,
+  STARTUP_DISCOVERY = 4
+};
+
+static unsigned int startup_pending = 0;
+static const char *startup_ipaddr = NULL;
+static int startup_port = HEADLESS_DEFAULT_PORT;
+static int startup_rc = 0;
+static int radio_started = 0;
+static char *wisdom_dir = NULL;
+
+static DISCOVERED *headless_pick_radio(const char *ipaddr) {
+  t_print("%s: %d devices discovered\n", __func__, devices);
+
+  for (int i = 0; i < devices; i++) {
+    DISCOVERED *d = &discovered[i];
+
+    if (d->status != STATE_AVAILABLE) { continue; }
+
+    if (ipaddr && strcmp(ipaddr, inet_ntoa(d->info.network.address.sin_addr)) != 0) { continue; }
+
+    t_print("%s: using %s (protocol %d) at %s\n", __func__, d->name, d->protocol,
+            inet_ntoa(d->info.network.address.sin_addr));
+    return d;
+  }
+
+  return NULL;
+}
+
+static gboolean headless_stage_done(gpointer data) {
+  startup_pending &= ~GPOINTER_TO_UINT(data);
+
+  if (startup_pending) { return G_SOURCE_REMOVE; }
+
+  radio = headless_pick_radio(startup_ipaddr);
+
+  if (radio == NULL) {
+    t_print("%s: no radio found\n", __func__);
+    startup_rc = 1;
+    g_main_loop_quit(headless_loop);
+    return G_SOURCE_REMOVE;
+  }
+
+  radio_start_headless();
+  radio_started = 1;
+
+  if (headless_open_socket(startup_port) < 0) {
+    startup_rc = 1;
+    g_main_loop_quit(headless_loop);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer headless_wisdom_thread(gpointer data) {
+  t_print("%s: securing wisdom file in directory: %s\n", __func__, wisdom_dir);
+  WDSPwisdom(wisdom_dir);
+  g_idle_add(headless_stage_done, GUINT_TO_POINTER(STARTUP_WISDOM));
+  return NULL;
+}
+
+static gpointer headless_discovery_thread(gpointer data) {
+  devices = 0;
+  old_discovery();
+  new_discovery();
+  g_idle_add(headless_stage_done, GUINT_TO_POINTER(STARTUP_DISCOVERY));
+  return NULL;
+}
+
+int headless_main(int argc, char **argv) {
+  const char *ipaddr = NULL;
+  int port = HEADLESS_DEFAULT_PORT;
+  int c;
+  headless = 1;
+  deskhpsdr_main_thread = pthread_self();
+
+  while ((c = getopt(argc, argv, "a:p:")) != -1) {
+    switch (c) {
+    case 'a':
+      ipaddr = optarg;
+      break;
+
+    case 'p':
+      port = atoi(optarg);
+      break;
+
+    default:
+      fprintf(stderr, "Usage: deskHPSDR -H [-a radio-ip-addr] [-p command-port]\n");
+      return 1;
+    }
+  }
+
+  headless_loop = g_main_loop_new(NULL, FALSE);
+  startup_ipaddr = ipaddr;
+  startup_port = port;
+  startup_pending = STARTUP_AUDIO | STARTUP_WISDOM | STARTUP_DISCOVERY;
+
+  wisdom_dir = wisdom_cache_dir();
+  g_thread_unref(g_thread_new("WISDOM", headless_wisdom_thread, NULL));
+  g_thread_unref(g_thread_new("DISCOVERY", headless_discovery_thread, NULL));
+  audio_get_cards();
+  g_idle_add(headless_stage_done, GUINT_TO_POINTER(STARTUP_AUDIO));
+  g_main_loop_run(headless_loop);
+
+  if (startup_rc) {
+    if (radio_started) { stop_program(); }
+
+    g_main_loop_unref(headless_loop);
+    return startup_rc;
+  }
+
+  t_print("%s: exiting ...\n", __func__);
+  stop_program();
+  p2cap_stop_recording();
+#ifdef P2TRACE
+  p2trace_exit();
+#endif
+  if (cmd_channel) {
+    g_source_remove(cmd_watch);
+    g_io_channel_unref(cmd_channel);    // this also closes cmd_socket
+    cmd_channel = NULL;
+    cmd_socket = -1;
+  }
+
+  g_main_loop_unref(headless_loop);
+  return 0;
+}
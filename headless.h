@@ -0,0 +1,36 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _HEADLESS_H_
+#define _HEADLESS_H_
+
+//
+// Headless mode: deskHPSDR is started with "-H" as the first argument.
+// There is no display and no GTK main loop, the program is controlled
+// through a line-oriented TCP command socket.
+//
+// Usage: deskHPSDR -H [-a radio-ip-addr] [-p command-port]
+//
+
+#define HEADLESS_DEFAULT_PORT 19001
+
+extern int headless;
+
+extern int headless_main(int argc, char **argv);
+
+#endif
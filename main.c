@@ -63,8 +63,12 @@
 #include "vfo.h"
 #include "css.h"
 #include "exit_menu.h"
+#include "headless.h"
 #include "message.h"
+#include "p2capture.h"
+#include "p2trace.h"
 #include "startup.h"
+#include "wisdomcache.h"
 #ifdef TTS
   #include "tts.h"
 #endif
@@ -165,6 +169,11 @@ static void enforce_x11_backend_policy(void) {
 #endif
 
 void status_text(const char *text) {
+  if (headless) {
+    t_print("%s\n", text);
+    return;
+  }
+
   gtk_label_set_text(GTK_LABEL(status_label), text);
   usleep(100000);
 
@@ -173,8 +182,51 @@ void status_text(const char *text) {
   }
 }
 
+//
+// Start-up stages. Securing the FFTW wisdom file runs in its own thread
+// while the audio devices are enumerated in the GTK thread. Each stage
+// reports its completion in the GTK thread, and the discovery starts as
+// soon as both are complete. There is no polling: while the wisdom
+// thread runs, the GTK main loop is running and a timer only refreshes
+// the status text.
+//
+enum {
+  STARTUP_AUDIO  = 1,
+  STARTUP_WISDOM = 2
+};
+
 static pthread_t wisdom_thread_id;
 static int wisdom_running = 0;
+static unsigned int startup_pending = 0;
+static char wisdom_directory[1025];
+
+static void startup_stage_done(unsigned int stage) {
+  startup_pending &= ~stage;
+
+  if (startup_pending == 0) {
+    //
+    // When wisdom plans and audio devices are complete, start discovery process
+    //
+    g_idle_add(delayed_discovery, NULL);
+  }
+}
+
+static gboolean wisdom_done_cb(gpointer data) {
+  pthread_join(wisdom_thread_id, NULL);
+  startup_stage_done(STARTUP_WISDOM);
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean wisdom_status_cb(gpointer data) {
+  char text[1024];
+
+  if (!__atomic_load_n(&wisdom_running, __ATOMIC_ACQUIRE)) { return G_SOURCE_REMOVE; }
+
+  snprintf(text, sizeof(text), "Please do not close this window until wisdom plans are completed ...\n\n... %s",
+           wisdom_get_status());
+  gtk_label_set_text(GTK_LABEL(status_label), text);
+  return G_SOURCE_CONTINUE;
+}
 
 static void* wisdom_thread(void *arg) {
   int wdsp_subversion = GetWDSPVersion() % 100;
@@ -186,7 +238,8 @@ static void* wisdom_thread(void *arg) {
     t_print("%s: Re-using existing WDSP wisdom file.\n", __func__);
   }
 
-  wisdom_running = 0;
+  __atomic_store_n(&wisdom_running, 0, __ATOMIC_RELEASE);
+  g_idle_add(wisdom_done_cb, NULL);
   return NULL;
 }
 
@@ -652,6 +705,10 @@ gboolean main_delete (GtkWidget *widget) {
     stop_program();
   }
 
+  p2cap_stop_recording();
+#ifdef P2TRACE
+  p2trace_exit();
+#endif
   _exit(0);
 }
 
@@ -677,11 +734,26 @@ static GdkPixbuf *create_pixbuf_from_data(void) {
 }
 
 static int init(void *data) {
-  char wisdom_directory[1025];
-  char text[1024];
+  char *dir;
   t_print("%s\n", __func__);
   t_print("LC_ALL=%s\n", setlocale(LC_ALL, NULL));
   t_print("LC_NUMERIC=%s\n", setlocale(LC_NUMERIC, NULL));
+  startup_pending = STARTUP_AUDIO | STARTUP_WISDOM;
+  //
+  // Let WDSP (via FFTW) check for wisdom file in the wisdom cache
+  // directory for this CPU and WDSP version (see wisdomcache.c).
+  // If there is one, the "wisdom thread" takes no time
+  // Depending on the WDSP version, the file is wdspWisdom or wdspWisdom00.
+  // The thread is started first, so that it runs while the
+  // audio devices are enumerated.
+  //
+  dir = wisdom_cache_dir();
+  g_strlcpy(wisdom_directory, dir, sizeof(wisdom_directory));
+  g_free(dir);
+  t_print("Securing wisdom file in directory: %s\n", wisdom_directory);
+  status_text("Checking FFTW Wisdom file ...");
+  wisdom_running = 1;
+  pthread_create(&wisdom_thread_id, NULL, wisdom_thread, wisdom_directory);
   audio_get_cards();
   {
     GdkDisplay *dpy = gdk_display_get_default();
@@ -696,36 +768,8 @@ static int init(void *data) {
 
     gdk_window_set_cursor(gtk_widget_get_window(top_window), cursor_watch);
   }
-  //
-  // Let WDSP (via FFTW) check for wisdom file in current dir
-  // If there is one, the "wisdom thread" takes no time
-  // Depending on the WDSP version, the file is wdspWisdom or wdspWisdom00.
-  //
-  (void) getcwd(text, sizeof(text));
-  snprintf(wisdom_directory, sizeof(wisdom_directory), "%s/", text);
-  t_print("Securing wisdom file in directory: %s\n", wisdom_directory);
-  status_text("Checking FFTW Wisdom file ...");
-  wisdom_running = 1;
-  pthread_create(&wisdom_thread_id, NULL, wisdom_thread, wisdom_directory);
-
-  while (wisdom_running) {
-    // wait for the wisdom thread to complete, meanwhile
-    // handling any GTK events.
-    usleep(100000); // 100ms
-
-    while (gtk_events_pending ()) {
-      gtk_main_iteration ();
-    }
-
-    snprintf(text, sizeof(text), "Please do not close this window until wisdom plans are completed ...\n\n... %s",
-             wisdom_get_status());
-    status_text(text);
-  }
-
-  //
-  // When widsom plans are complete, start discovery process
-  //
-  g_timeout_add(100, delayed_discovery, NULL);
+  startup_stage_done(STARTUP_AUDIO);
+  g_timeout_add(100, wisdom_status_cb, NULL);
   return 0;
 }
 
@@ -997,6 +1041,15 @@ int main(int argc, char **argv) {
   t_print("%s: init global cURL...\n", __func__);
   curl_global_init(CURL_GLOBAL_ALL);
   toolset_init();
+  band_init();
+
+  //
+  // If invoked with -H, run without GUI (see headless.c)
+  //
+  if (argc >= 2 && !strcmp("-H", argv[1])) {
+    return headless_main(argc - 1, argv + 1);
+  }
+
   snprintf(name, 1024, "org.dl1bz.deskhpsdr.pid%d", getpid());
   t_print("%s: gtk_application_new: %s -> X11 backend use Wayland ? : %d\n", __func__, name, use_wayland);
   gtk_disable_setlocale();  // keep having a decimal point as a decimal point
@@ -60,6 +60,12 @@
 #include "iambic.h"
 #include "rigctl.h"
 #include "message.h"
+#include "p2capture.h"
+#include "p2metrics.h"
+#include "p2trace.h"
+#include "rtlog.h"
+#include "divcombiner.h"
+#include "spectrum_rx.h"
 
 #ifdef SATURN
   #include "saturnmain.h"
@@ -88,9 +94,46 @@
 #define RXACTION_NORMAL 1    // deliver 238 samples to a receiver
 #define RXACTION_PS     2    // deliver 2*119 samples to PS engine
 #define RXACTION_DIV    3    // take 2*119 samples, mix them, deliver to a receiver
+#define RXACTION_SPEC   4    // deliver 238 samples to a spectrum-only receiver
 
-static int rxcase[MAX_DDC];
-static int rxid[MAX_DDC];
+#if MAX_DDC > P2M_MAX_DDC
+  #error "P2M_MAX_DDC in p2metrics.h must not be smaller than MAX_DDC"
+#endif
+
+//
+// The action table is double-buffered: update_action_table() fills in
+// the inactive copy and then publishes it with an atomic pointer swap.
+// Each entry packs the action and the receiver id into one int, so an
+// IQ thread always sees a consistent pair, even if the table changes
+// while it processes a packet.
+//
+#define RXACTION_ENTRY(action, id) ((action) | ((id) << 8))
+#define RXACTION_CASE(entry)       ((entry) & 0xFF)
+#define RXACTION_ID(entry)         ((entry) >> 8)
+
+typedef struct _action_table {
+  int entry[MAX_DDC];
+} ACTION_TABLE;
+
+static ACTION_TABLE action_tables[2];
+static ACTION_TABLE *action_table = &action_tables[0];
+static pthread_mutex_t action_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+//
+// State for in-place reconfiguration (see new_protocol_reconfigure_begin()).
+// iq_gen[ddc] is odd while the IQ thread of that DDC processes a packet,
+// and iq_flush_until[ddc] is a time (nsec) until which incoming packets
+// of that DDC are discarded. Both are shared between the GTK thread and
+// the IQ threads and only accessed atomically (iq_flush_until is 64 bit,
+// so a plain access may tear on 32-bit platforms).
+//
+#define P2_RECONF_FLUSH_NS 10000000ULL
+
+static int p2_reconfiguring = 0;
+static int iq_gen[MAX_DDC];
+static uint64_t iq_flush_until[MAX_DDC];
+static int reconf_entry[MAX_DDC];
+static int reconf_rate[MAX_DDC];
 
 int data_socket = -1;
 
@@ -123,6 +166,7 @@ static GThread *new_protocol_txiq_thread_id;
 static GThread *new_protocol_timer_thread_id;
 
 static unsigned long high_priority_sequence = 0;
+static unsigned int hp_vfo_version = 0;     // VFO snapshot used for the last HighPrio packet
 static unsigned long general_sequence = 0;
 static unsigned long rx_specific_sequence = 0;
 static unsigned long tx_specific_sequence = 0;
@@ -137,14 +181,14 @@ static unsigned long micsamples_sequence = 0;
   static sem_t *high_priority_sem_ready;
   static sem_t *high_priority_sem_buffer;
   static sem_t *mic_line_sem;
-  static sem_t *iq_sem[MAX_DDC];
+  static sem_t *iq_pool_sem;
   static sem_t *txiq_sem;
   static sem_t *rxaudio_sem;
 #else
   static sem_t high_priority_sem_ready;
   static sem_t high_priority_sem_buffer;
   static sem_t mic_line_sem;
-  static sem_t iq_sem[MAX_DDC];
+  static sem_t iq_pool_sem;
   static sem_t txiq_sem;
   static sem_t rxaudio_sem;
 #endif
@@ -153,6 +197,30 @@ static GThread *high_priority_thread_id;
 static GThread *mic_line_thread_id;
 static GThread *iq_thread_id[MAX_DDC];
 
+//
+// The IQ samples from the DDCs are processed by a pool of worker threads
+// (one per CPU core, at most one per DDC). A DDC with packets in its ring
+// buffer is put (once) into the queue of its "home" worker, and a worker
+// with an empty queue steals from the others. A DDC is processed by only
+// one worker at a time, so the packets of a DDC are processed in order,
+// while a busy DDC can move to any free core. Idle DDCs cost nothing.
+//
+// iq_pool_sem is posted once for each DDC put into a queue.
+//
+#define IQ_POOL_BATCH 4              // max. packets of a DDC per turn
+
+typedef struct _iq_worker {
+  pthread_mutex_t mutex;
+  int queue[MAX_DDC];                // DDCs ready for processing
+  int head;
+  int count;
+} IQ_WORKER;
+
+static IQ_WORKER iq_workers[MAX_DDC];
+static int iq_nworkers = 0;
+static int iq_scheduled[MAX_DDC];    // DDC is queued or being processed
+static long iq_expected_sequence[MAX_DDC];
+
 static unsigned long audio_sequence = 0;
 
 // Use this to determine the source port of messages received
@@ -271,15 +339,26 @@ static void new_protocol_general(void);
 static void new_protocol_receive_specific(void);
 static void new_protocol_transmit_specific(void);
 static gpointer new_protocol_thread(gpointer data);
+static gpointer new_protocol_replay_thread(gpointer data);
+static void new_protocol_dispatch(int sourceport, int bytesread, mybuffer *mybuf);
+
+//
+// Recording and replay of P2 sessions (see p2capture.c)
+//
+static char *p2_capture_file = NULL;
+static char *p2_replay_file = NULL;
+static int p2_replay_fast = 0;
 static gpointer new_protocol_rxaudio_thread(gpointer data);
 static gpointer new_protocol_txiq_thread(gpointer data);
 static gpointer new_protocol_timer_thread(gpointer data);
 static gpointer high_priority_thread(gpointer data);
 static gpointer mic_line_thread(gpointer data);
 static gpointer iq_thread(gpointer data);
+static void iq_schedule(int ddc);
 static void  process_iq_data(const unsigned char *buffer, RECEIVER *rx);
 static void  process_ps_iq_data(const unsigned char *buffer);
 static void process_div_iq_data(const unsigned char *buffer);
+static void  process_spectrum_iq_data(const unsigned char *buffer, SPECTRUM_RX *srx);
 static void  process_high_priority(void);
 static void  process_mic_data(const unsigned char *buffer);
 
@@ -314,49 +393,232 @@ static mybuffer *get_my_buffer(void) {
     num_buf++;
   }
 
-  t_print("NewProtocol: number of buffers increased to %d\n", num_buf);
+  RT_PRINT("NewProtocol: number of buffers increased to %d\n", num_buf);
   // Mark the first buffer in list as used and return that one.
   buflist->free = 0;
   return buflist;
 }
 
+static gboolean schedule_high_priority_cb(gpointer data) {
+  schedule_high_priority();
+  return G_SOURCE_REMOVE;
+}
+
 void schedule_high_priority(void) {
+  P2TRACE_INSTANT("schedule_high_priority", 0);
+
+  //
+  // Changes of the VFO state are usually followed by a call to this
+  // function, so this is the place to publish them for the HighPrio
+  // packet (which is also sent from other threads).
+  // vfo[] is written by the GTK thread, and only there a consistent
+  // copy can be taken, so calls from other threads are handed over.
+  //
+  if (!g_main_context_is_owner(g_main_context_default())) {
+    g_idle_add(schedule_high_priority_cb, NULL);
+    return;
+  }
+
+  vfo_publish();
+
   if (protocol == NEW_PROTOCOL) {
     new_protocol_high_priority();
   }
 }
 
 void schedule_general(void) {
+  P2TRACE_INSTANT("schedule_general", 0);
+
   if (protocol == NEW_PROTOCOL) {
     new_protocol_general();
   }
 }
 
 void schedule_receive_specific(void) {
+  P2TRACE_INSTANT("schedule_receive_specific", 0);
+
   if (protocol == NEW_PROTOCOL) {
     new_protocol_receive_specific();
   }
 }
 
 void schedule_transmit_specific(void) {
+  P2TRACE_INSTANT("schedule_transmit_specific", 0);
+
   if (protocol == NEW_PROTOCOL) {
     new_protocol_transmit_specific();
   }
 }
 
-void update_action_table(void) {
+//
+// DDC assignment
+//
+// For HERMES, receiver[i] is associated with DDC(i). Beyond (that is,
+// ANGELIA, ORION, ORION2, SATURN) DDC0 and DDC1 are reserved for
+// PureSignal and DIVERSITY, and receiver[i] is associated with DDC(i+2).
+// The number of DDCs is the one the radio reports in its discovery
+// reply, limited by MAX_DDC. Only if the discovery data has none (older
+// discovery code) the number of the standard firmware of the board is
+// assumed.
+//
+static int p2_rx_ddc_base(void) {
+  switch (device) {
+  case NEW_DEVICE_ANGELIA:
+  case NEW_DEVICE_ORION:
+  case NEW_DEVICE_ORION2:
+  case NEW_DEVICE_SATURN:
+    return 2;
+
+  default:
+    return 0;
+  }
+}
+
+static int p2_ddc_count(void) {
+  int n = radio->ddcs;
+
+  if (n <= 0) {
+    switch (device) {
+    case NEW_DEVICE_ANGELIA:
+    case NEW_DEVICE_ORION:
+    case NEW_DEVICE_ORION2:
+      n = 8;
+      break;
+
+    case NEW_DEVICE_SATURN:
+      n = 10;
+      break;
+
+    default:
+      n = 4;
+      break;
+    }
+  }
+
+  return min(n, MAX_DDC);
+}
+
+//
+// Max. number of receivers that can be served (each one with its own DDC)
+//
+int new_protocol_max_receivers(void) {
+  int n = p2_ddc_count() - p2_rx_ddc_base();
+  return n > 0 ? n : 0;
+}
+
+//
+// Spectrum-only receivers get DDCs following those of the receivers,
+// as far as available. The DDC is chosen by new_protocol_spectrum_ddc()
+// when the spectrum receiver is created, and kept for its lifetime, so
+// that removing one spectrum receiver does not move the others. Should
+// the receivers later need that DDC, the spectrum receiver has none.
+// p2_spectrum_ddcs() stores the DDC of each spectrum receiver (or -1)
+// in ddc[] and returns the number of them that have a DDC.
+//
+static int p2_first_spectrum_ddc(void) {
+  return p2_rx_ddc_base() + min(receivers, new_protocol_max_receivers());
+}
+
+static int p2_spectrum_ddcs(int *ddc) {
+  int first = p2_first_spectrum_ddc();
+  int n = 0;
+
+  for (int i = 0; i < MAX_SPECTRUM_RX; i++) {
+    const SPECTRUM_RX *srx = __atomic_load_n(&spectrum_rx[i], __ATOMIC_ACQUIRE);
+    ddc[i] = -1;
+
+    if (srx != NULL && srx->ddc >= first && srx->ddc < p2_ddc_count()) {
+      ddc[i] = srx->ddc;
+      n++;
+    }
+  }
+
+  return n;
+}
+
+//
+// Lowest DDC not used by the receivers and spectrum receivers,
+// or -1 if there is none. Must be called from the GTK thread.
+//
+int new_protocol_spectrum_ddc(void) {
+  int sddc[MAX_SPECTRUM_RX];
+  p2_spectrum_ddcs(sddc);
+
+  for (int ddc = p2_first_spectrum_ddc(); ddc < p2_ddc_count(); ddc++) {
+    int used = 0;
+
+    for (int i = 0; i < MAX_SPECTRUM_RX; i++) {
+      if (sddc[i] == ddc) { used = 1; }
+    }
+
+    if (!used) { return ddc; }
+  }
+
+  return -1;
+}
+
+//
+// Receivers beyond the VFOs (e.g. additional narrow receivers for
+// monitoring) have no VFO, their DDC frequency is set here.
+//
+static long long p2_rx_frequency[MAX_DDC];
+
+void new_protocol_set_rx_frequency(int id, long long frequency) {
+  if (id < MAX_VFOS || id >= MAX_DDC) { return; }
+
+  __atomic_store_n(&p2_rx_frequency[id], frequency, __ATOMIC_RELEASE);
+  schedule_high_priority();
+}
+
+//
+// Action table rules. Depending on the values of mox, puresignal, and
+// diversity, a flag is computed (see update_action_table()), and the rule
+// for this flag tells what to do with DDC0 and whether the receivers get
+// their samples from their DDCs.
+//
+typedef struct _action_rule {
+  int flag;
+  int ddc0;            // action for DDC0 (receiver 0 if RXACTION_DIV)
+  int rx;              // if set, receiver[i] is fed from its DDC
+} ACTION_RULE;
+
+static const ACTION_RULE action_rules[] = {
+  {     0, RXACTION_SKIP,   1 },         // HERMES, RX, no DIVERSITY
+  { 10100, RXACTION_SKIP,   1 },         // HERMES, TX, no PureSignal, DUPLEX
+  {     1, RXACTION_DIV,    0 },         // never occurs since HERMES has only 1 ADC
+  {  1001, RXACTION_DIV,    0 },         // ORION, RX, DIVERSITY
+  {   100, RXACTION_SKIP,   0 },         // HERMES, TX, no PureSignal, no DUPLEX: just skip samples
+  {  1100, RXACTION_SKIP,   0 },         // ORION, TX, no PureSignal, no DUPLEX: just skip samples
+  {   110, RXACTION_PS,     0 },         // HERMES, TX, PureSignal, no DUPLEX
+  {  1110, RXACTION_PS,     0 },         // ORION, TX, PureSignal, no DUPLEX
+  { 10110, RXACTION_PS,     0 },         // HERMES, TX, DUPLEX, PS: duplex is ignored
+  { 11110, RXACTION_PS,     1 },         // ORION, TX, PureSignal, DUPLEX
+  {  1000, RXACTION_SKIP,   1 },         // ORION, RX, no DIVERSITY
+  { 11100, RXACTION_SKIP,   1 },         // ORION, TX, no PureSignal, DUPLEX
+};
+
+//
+// Compute the action table entries for the current state, without
+// publishing them. While reconfiguring, all DDCs are skipped, unless
+// the caller asks for the table that will be valid afterwards.
+//
+static void action_table_entries(int *entry, int reconfiguring) {
   //
   // Depending on the values of mox, puresignal, and diversity,
   // determine the actions to be taken when a DDC packet arrives
   //
   int flag = 0;
+  int rxcase[MAX_DDC] = { RXACTION_SKIP };
+  int rxid[MAX_DDC] = { 0 };
+  int sddc[MAX_SPECTRUM_RX];
+  const ACTION_RULE *rule = NULL;
   int xmit = radio_is_transmitting(); // store such that it cannot change while building the flag
-  int newdev = (device == NEW_DEVICE_ANGELIA  || device == NEW_DEVICE_ORION ||
-                device == NEW_DEVICE_ORION2 || device == NEW_DEVICE_SATURN);
+  int base = p2_rx_ddc_base();
+  int nddc = p2_ddc_count();
 
   if (duplex && xmit) { flag += 10000; }
 
-  if (newdev) { flag += 1000; }
+  if (base > 0) { flag += 1000; }
 
   if (xmit) { flag += 100; }
 
@@ -368,80 +630,65 @@ void update_action_table(void) {
   // make no difference upon RXing
   // Note further, we do not use the diversity mixer upon transmitting.
   //
-  // Therefore, the following 12 values for flag are possible:
-  // flag=     0
-  // flag=     1
-  // flag=   100
-  // flag=   110
-  // flag=  1000
-  // flag=  1001
-  // flag=  1100
-  // flag=  1110
-  // flag= 10100
-  // flag= 10110
-  // flag= 11100
-  // flag= 11110
-  //
-  // Set up rxcase and rxid for each of the 12 cases
-  // note that rxid[i] can be left unspecified if rxcase[i] == RXACTION_SKIP
-  //
-  rxcase[0] = RXACTION_SKIP;
-  rxcase[1] = RXACTION_SKIP;
-  rxcase[2] = RXACTION_SKIP;
-  rxcase[3] = RXACTION_SKIP;
-
-  switch (flag) {
-  case       0:                                                       // HERMES, RX, no DIVERSITY
-  case   10100:                                                       // HERMES, TX, no PureSignal, DUPLEX
-    rxid[0] = 0;
-    rxcase[0] = RXACTION_NORMAL;
-
-    if (receivers > 1) {
-      rxid[1] = 1;
-      rxcase[1] = RXACTION_NORMAL;
+  // Therefore, only the 12 values for flag listed in action_rules[] are possible.
+  // Note that rxid[i] can be left unspecified if rxcase[i] == RXACTION_SKIP
+  //
+  for (int i = 0; i < (int)(sizeof(action_rules) / sizeof(action_rules[0])); i++) {
+    if (action_rules[i].flag == flag) {
+      rule = &action_rules[i];
+      break;
     }
+  }
 
-    break;
-
-  case     1:                                                         // never occurs since HERMES has only 1 ADC
-  case  1001:                                                         // ORION, RX, DIVERSITY
-    rxid[0] = 0;
-    rxcase[0] = RXACTION_DIV;
-    break;
-
-  case  100:                                                          // HERMES or ORION, TX, no PureSignal, no DUPLEX
-  case 1100:
-    // just skip samples
-    break;
-
-  case  110:                                                          // HERMES or ORION, TX, PureSignal, no DUPLEX
-  case 1110:
-  case 10110:                                                         // HERMES, TX, DUPLEX, PS: duplex is ignored
-    rxcase[0] = RXACTION_PS;
-    break;
+  if (rule == NULL) {
+    t_print("ACTION TABLE: case not handled: %d\n", flag);
+  } else {
+    rxcase[0] = rule->ddc0;
 
-  case 11110:                                                         // ORION, TX, PureSignal, DUPLEX
-    rxcase[0] = RXACTION_PS;
-    __attribute__((fallthrough));
+    if (rule->rx) {
+      for (int id = 0; id < receivers && base + id < nddc; id++) {
+        rxid[base + id] = id;
+        rxcase[base + id] = RXACTION_NORMAL;
+      }
 
-  case 1000:                                                          // ORION, RX, no DIVERSITY
-  case 11100:                                                         // ORION, TX, no PureSignal, DUPLEX
-    rxid[2] = 0;
-    rxcase[2] = RXACTION_NORMAL;
+      p2_spectrum_ddcs(sddc);
 
-    if (receivers > 1) {
-      rxid[3] = 1;
-      rxcase[3] = RXACTION_NORMAL;
+      for (int id = 0; id < MAX_SPECTRUM_RX; id++) {
+        if (sddc[id] >= 0) {
+          rxid[sddc[id]] = id;
+          rxcase[sddc[id]] = RXACTION_SPEC;
+        }
+      }
     }
+  }
 
-    break;
+  //
+  // While reconfiguring, no samples are delivered at all
+  //
+  if (reconfiguring) {
+    memset(rxcase, 0, sizeof(rxcase));
+  }
 
-  default:
-    t_print("ACTION TABLE: case not handled: %d\n", flag);
-    break;
+  for (int i = 0; i < MAX_DDC; i++) {
+    entry[i] = RXACTION_ENTRY(rxcase[i], rxid[i]);
   }
 }
 
+static void publish_action_table(const int *entry) {
+  ACTION_TABLE *table;
+  pthread_mutex_lock(&action_mutex);
+  table = (action_table == &action_tables[0]) ? &action_tables[1] : &action_tables[0];
+  memcpy(table->entry, entry, sizeof(table->entry));
+  __atomic_store_n(&action_table, table, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&action_mutex);
+}
+
+void update_action_table(void) {
+  int entry[MAX_DDC];
+  action_table_entries(entry, __atomic_load_n(&p2_reconfiguring, __ATOMIC_ACQUIRE));
+  publish_action_table(entry);
+}
+
 void new_protocol_init(void) {
   int i;
 
@@ -465,6 +712,27 @@ void new_protocol_init(void) {
 
   TXIQRINGBUF = g_new(unsigned char, TXIQRINGBUFLEN);
   RXAUDIORINGBUF = g_new(unsigned char, RXAUDIORINGBUFLEN);
+  p2metrics_init();
+  rtlog_init();
+#ifdef P2TRACE
+  p2trace_init();
+#endif
+  //
+  // Recording/replay of P2 sessions is controlled by environment variables,
+  // since it is meant for regression and performance tests only.
+  // Replay is not possible when using the XDMA interface.
+  //
+  p2_capture_file = getenv("DESKHPSDR_P2_CAPTURE");
+  p2_replay_file = getenv("DESKHPSDR_P2_REPLAY");
+  p2_replay_fast = (getenv("DESKHPSDR_P2_REPLAY_FAST") != NULL);
+
+  if (have_saturn_xdma) {
+    p2_replay_file = NULL;
+  }
+
+  if (p2_capture_file != NULL && p2_replay_file == NULL) {
+    p2cap_start_recording(p2_capture_file);
+  }
 
   if (transmitter->local_microphone) {
     if (audio_open_input() != 0) {
@@ -481,27 +749,26 @@ void new_protocol_init(void) {
   high_priority_sem_ready = apple_sem(0);
   high_priority_sem_buffer = apple_sem(0);
   mic_line_sem = apple_sem(0);
-
-  for (i = 0; i < MAX_DDC; i++) {
-    iq_sem[i] = apple_sem(0);
-  }
-
+  iq_pool_sem = apple_sem(0);
 #else
   (void)sem_init(&high_priority_sem_ready, 0, 0); // check return value!
   (void)sem_init(&high_priority_sem_buffer, 0, 0); // check return value!
   (void)sem_init(&mic_line_sem, 0, 0); // check return value!
-
-  for (i = 0; i < MAX_DDC; i++) {
-    (void)sem_init(&iq_sem[i], 0, 0); // check return value!
-  }
-
+  (void)sem_init(&iq_pool_sem, 0, 0); // check return value!
 #endif
   high_priority_thread_id = g_thread_new( "P2 HP", high_priority_thread, NULL);
   mic_line_thread_id = g_thread_new( "P2 MIC", mic_line_thread, NULL);
 
-  for (i = 0; i < MAX_DDC; i++) {
+  iq_nworkers = min((int) g_get_num_processors(), MAX_DDC);
+
+  if (iq_nworkers < 1) { iq_nworkers = 1; }
+
+  t_print("%s: %d IQ worker threads\n", __func__, iq_nworkers);
+
+  for (i = 0; i < iq_nworkers; i++) {
     char text[16];
-    snprintf(text, 16, "P2 DDC%d", i);
+    pthread_mutex_init(&iq_workers[i].mutex, NULL);
+    snprintf(text, 16, "P2 IQ%d", i);
     iq_thread_id[i] = g_thread_new(text, iq_thread, GINT_TO_POINTER(i));
   }
 
@@ -639,9 +906,11 @@ void new_protocol_init(void) {
 static void new_protocol_general(void) {
   const BAND *band;
   int rc;
+  struct _vfo v[MAX_VFOS];
+  int rxvfo, txvfo;
+  vfo_snapshot(v, &rxvfo, &txvfo);
   pthread_mutex_lock(&general_mutex);
-  int txvfo = vfo_get_tx_vfo();
-  band = band_get_band(vfo[txvfo].band);
+  band = band_get_band(v[txvfo].band);
   memset(general_buffer, 0, sizeof(general_buffer));
   general_buffer[0] = (general_sequence >> 24) & 0xFF;
   general_buffer[1] = (general_sequence >> 16) & 0xFF;
@@ -679,6 +948,9 @@ static void new_protocol_general(void) {
     saturn_handle_general_packet(false, general_buffer);
 #endif
   } else {
+    P2CAP_RECORD(P2CAP_TO_RADIO, ntohs(base_addr.sin_port), general_buffer, sizeof(general_buffer));
+    P2TRACE_INSTANT("sendto general", ntohs(base_addr.sin_port));
+
     if ((rc = sendto(data_socket, general_buffer, sizeof(general_buffer), 0, (struct sockaddr * )&base_addr,
                      base_addr_length)) < 0) {
       g_idle_add(fatal_error, "GP send failed (Network down?)");
@@ -694,21 +966,51 @@ static void new_protocol_general(void) {
   pthread_mutex_unlock(&general_mutex);
 }
 
+//
+// Frequency determining the band-pass filter of an ADC: that of the
+// active receiver if it uses this ADC, otherwise that of the first
+// receiver using this ADC, and zero if there is none.
+//
+static long long p2_bpf_frequency(int adc, int rxvfo, int nrx, const long long *DDCfrequency) {
+  if (rxvfo < nrx && receiver[rxvfo]->adc == adc) {
+    return DDCfrequency[rxvfo];
+  }
+
+  for (int id = 0; id < nrx; id++) {
+    if (receiver[id]->adc == adc) {
+      return DDCfrequency[id];
+    }
+  }
+
+  return 0LL;
+}
+
 static void new_protocol_high_priority(void) {
   int rxant, txant;
-  long long DDCfrequency[2];  // DDC frequencies of the radio
+  long long DDCfrequency[MAX_DDC]; // DDC frequencies of the receivers
   long long DUCfrequency;     // DUC frequency of the radio
   long long txfreq;           // frequency used for out-of-band detection
   long long HPFfreq;          // frequency determining the HPF filters
   long long LPFfreq;          // frequency determining the LPF filters
   long long BPFfreq;          // frequency determining the BPF filters
   unsigned long phase;
+  struct _vfo v[MAX_VFOS];    // consistent copy of the VFO state
+  int txvfo;                  // VFO governing the TX frequency
+  int rxvfo;                  // id of the active receiver
+  unsigned int version;
 
   if (data_socket == -1 && !have_saturn_xdma) {
     return;
   }
 
+  version = vfo_snapshot(v, &rxvfo, &txvfo);
   pthread_mutex_lock(&hi_prio_mutex);
+
+  if (version != hp_vfo_version) {
+    P2TRACE_INSTANT("HighPrio new VFO state", (int) version);
+    hp_vfo_version = version;
+  }
+
   memset(high_priority_buffer_to_radio, 0, sizeof(high_priority_buffer_to_radio));
   //
   // If deskHPSDR is not (yet) transmitting, but a PTT signal came from the
@@ -716,12 +1018,10 @@ static void new_protocol_high_priority(void) {
   // To this end, radio_is_transmitting() is ORed with radio_ptt.
   //
   int xmit     = radio_is_transmitting() | radio_ptt;
-  int txvfo    = vfo_get_tx_vfo();    // VFO governing the TX frequency
-  int rxvfo    = active_receiver->id; // id of the active receiver
-  int othervfo = 1 - rxvfo;           // id of the "other" receiver (only valid if receivers > 1)
-  int txmode   = vfo_get_tx_mode();
-  const BAND *txband = band_get_band(vfo[txvfo].band);
-  const BAND *rxband = band_get_band(vfo[rxvfo].band);
+  int nrx      = min(receivers, new_protocol_max_receivers());
+  int txmode   = v[txvfo].mode;
+  const BAND *txband = band_get_band(v[txvfo].band);
+  const BAND *rxband = band_get_band(v[rxvfo].band);
   high_priority_buffer_to_radio[0] = (high_priority_sequence >> 24) & 0xFF;
   high_priority_buffer_to_radio[1] = (high_priority_sequence >> 16) & 0xFF;
   high_priority_buffer_to_radio[2] = (high_priority_sequence >>  8) & 0xFF;
@@ -753,23 +1053,28 @@ static void new_protocol_high_priority(void) {
   }
 
   //
-  //  Set DDC frequencies for RX1 and RX2
+  //  Set DDC frequencies for all receivers
   //
-  for (int id = 0; id < 2; id++) {
+  for (int id = 0; id < nrx; id++) {
+    if (id >= MAX_VFOS) {
+      DDCfrequency[id] = apply_ppm_ll(__atomic_load_n(&p2_rx_frequency[id], __ATOMIC_ACQUIRE));
+      continue;
+    }
+
     // DDCfrequency[id] = vfo[id].frequency - vfo[id].lo;
     // if (vfo[id].rit_enabled) {
     //  DDCfrequency[id] += vfo[id].rit;
     // }
-    DDCfrequency[id] = vfo[id].frequency;
+    DDCfrequency[id] = v[id].frequency;
 
-    if (vfo[id].mode == modeCWU) {
+    if (v[id].mode == modeCWU) {
       DDCfrequency[id] -= (long long)cw_keyer_sidetone_frequency;
-    } else if (vfo[id].mode == modeCWL) {
+    } else if (v[id].mode == modeCWL) {
       DDCfrequency[id] += (long long)cw_keyer_sidetone_frequency;
     }
 
     // DDCfrequency[id] += frequency_calibration -  vfo[id].lo;
-    DDCfrequency[id] = apply_ppm_ll(DDCfrequency[id] - vfo[id].lo);
+    DDCfrequency[id] = apply_ppm_ll(DDCfrequency[id] - v[id].lo);
   }
 
   // CW mode from the Host; disabled since deskhpsdr does not use this CW option.
@@ -794,25 +1099,35 @@ static void new_protocol_high_priority(void) {
     //
     // Set frequencies for all receivers
     //
-    // note that for HERMES, receiver[i] is associated with DDC(i) but beyond
-    // (that is, ANGELIA, ORION, ORION2, SATURN) receiver[i] is associated with DDC(i+2)
-    int ddc = 0;
+    int base = p2_rx_ddc_base();
 
-    if (device == NEW_DEVICE_ANGELIA  || device == NEW_DEVICE_ORION ||
-        device == NEW_DEVICE_ORION2 || device == NEW_DEVICE_SATURN) { ddc = 2; }
+    for (int id = 0; id < nrx; id++) {
+      int ddc = base + id;
+      phase = (unsigned long)(((double)DDCfrequency[id]) * 34.952533333333333333333333333333);
+      high_priority_buffer_to_radio[ 9 + (ddc * 4)] = (phase >> 24) & 0xFF;
+      high_priority_buffer_to_radio[10 + (ddc * 4)] = (phase >> 16) & 0xFF;
+      high_priority_buffer_to_radio[11 + (ddc * 4)] = (phase >>  8) & 0xFF;
+      high_priority_buffer_to_radio[12 + (ddc * 4)] = (phase      ) & 0xFF;
+    }
 
-    phase = (unsigned long)(((double)DDCfrequency[0]) * 34.952533333333333333333333333333);
-    high_priority_buffer_to_radio[ 9 + (ddc * 4)] = (phase >> 24) & 0xFF;
-    high_priority_buffer_to_radio[10 + (ddc * 4)] = (phase >> 16) & 0xFF;
-    high_priority_buffer_to_radio[11 + (ddc * 4)] = (phase >>  8) & 0xFF;
-    high_priority_buffer_to_radio[12 + (ddc * 4)] = (phase      ) & 0xFF;
+    //
+    // Spectrum-only receivers
+    //
+    int sddc[MAX_SPECTRUM_RX];
+    p2_spectrum_ddcs(sddc);
 
-    if (receivers > 1) {
-      phase = (unsigned long)(((double)DDCfrequency[1]) * 34.952533333333333333333333333333);
-      high_priority_buffer_to_radio[13 + (ddc * 4)] = (phase >> 24) & 0xFF;
-      high_priority_buffer_to_radio[14 + (ddc * 4)] = (phase >> 16) & 0xFF;
-      high_priority_buffer_to_radio[15 + (ddc * 4)] = (phase >>  8) & 0xFF;
-      high_priority_buffer_to_radio[16 + (ddc * 4)] = (phase      ) & 0xFF;
+    for (int id = 0; id < MAX_SPECTRUM_RX; id++) {
+      const SPECTRUM_RX *srx = __atomic_load_n(&spectrum_rx[id], __ATOMIC_ACQUIRE);
+      int ddc = sddc[id];
+
+      if (ddc < 0 || srx == NULL) { continue; }
+
+      phase = (unsigned long)(((double)apply_ppm_ll(__atomic_load_n(&srx->frequency, __ATOMIC_ACQUIRE)))
+                              * 34.952533333333333333333333333333);
+      high_priority_buffer_to_radio[ 9 + (ddc * 4)] = (phase >> 24) & 0xFF;
+      high_priority_buffer_to_radio[10 + (ddc * 4)] = (phase >> 16) & 0xFF;
+      high_priority_buffer_to_radio[11 + (ddc * 4)] = (phase >>  8) & 0xFF;
+      high_priority_buffer_to_radio[12 + (ddc * 4)] = (phase      ) & 0xFF;
     }
   }
 
@@ -820,14 +1135,14 @@ static void new_protocol_high_priority(void) {
   //  Set DUC frequency.
   //  txfreq is the "on the air" frequency for out-of-band checking
   //
-  txfreq = vfo[txvfo].ctun ? vfo[txvfo].ctun_frequency : vfo[txvfo].frequency;
+  txfreq = v[txvfo].ctun ? v[txvfo].ctun_frequency : v[txvfo].frequency;
 
-  if (vfo[txvfo].xit_enabled) {
-    txfreq += vfo[txvfo].xit;
+  if (v[txvfo].xit_enabled) {
+    txfreq += v[txvfo].xit;
   }
 
   // DUCfrequency = txfreq - vfo[txvfo].lo + frequency_calibration;
-  DUCfrequency = apply_ppm_ll(txfreq - vfo[txvfo].lo);
+  DUCfrequency = apply_ppm_ll(txfreq - v[txvfo].lo);
   phase = (unsigned long)(((double)DUCfrequency) * 34.952533333333333333333333333333);
 
   if (xmit && transmitter->puresignal) {
@@ -1001,24 +1316,14 @@ static void new_protocol_high_priority(void) {
   case NEW_DEVICE_SATURN:
   case NEW_DEVICE_ORION2:
     //
-    // We have band-pass RX filters for ADC0 and ADC1. So if two
+    // We have band-pass RX filters for ADC0 and ADC1. So if several
     // receivers use the same ADC, the active one determines the
     // bandpass frequency.
     //
     //
     // ADC0 band pass
     //
-    BPFfreq = 0LL;
-
-    if (receivers > 1) {
-      if (receiver[othervfo]->adc == 0) {
-        BPFfreq = DDCfrequency[othervfo];   // Take frequency of non-active receiver
-      }
-    }
-
-    if (receiver[rxvfo]->adc == 0) {
-      BPFfreq = DDCfrequency[rxvfo];       // Take (overwrite with) frequency of active receiver
-    }
+    BPFfreq = p2_bpf_frequency(0, rxvfo, nrx, DDCfrequency);
 
     if (diversity_enabled) {
       BPFfreq = DDCfrequency[0];
@@ -1047,17 +1352,7 @@ static void new_protocol_high_priority(void) {
     //
     // ADC1 band pass
     //
-    BPFfreq = 0LL;
-
-    if (receivers > 1) {
-      if (receiver[othervfo]->adc == 1) {
-        BPFfreq = DDCfrequency[othervfo];   // Take frequency of non-active receiver
-      }
-    }
-
-    if (receiver[rxvfo]->adc == 1) {
-      BPFfreq = DDCfrequency[rxvfo];       // Take (overwrite with) frequency of active receiver
-    }
+    BPFfreq = p2_bpf_frequency(1, rxvfo, nrx, DDCfrequency);
 
     if (diversity_enabled) {
       BPFfreq = DDCfrequency[0];
@@ -1097,18 +1392,14 @@ static void new_protocol_high_priority(void) {
   default:
     //
     //      Old (ANAN-100/200) high-pass filters
-    //      If both RX are active and use ADC0,
-    //      HPF filter settings depend on MIN(rx1freq,rx2freq)
+    //      If several RX are active and use ADC0,
+    //      HPF filter settings depend on the lowest of their frequencies
     //
     HPFfreq = 0LL;
 
-    if (receiver[0]->adc == 0) {
-      HPFfreq = DDCfrequency[0];
-    }
-
-    if (receivers > 1) {
-      if (receiver[1]->adc == 0 && DDCfrequency[1] < DDCfrequency[0]) {
-        HPFfreq = DDCfrequency[1];
+    for (int id = 0; id < nrx; id++) {
+      if (receiver[id]->adc == 0 && (HPFfreq == 0LL || DDCfrequency[id] < HPFfreq)) {
+        HPFfreq = DDCfrequency[id];
       }
     }
 
@@ -1142,24 +1433,22 @@ static void new_protocol_high_priority(void) {
   //   Pre-Orion2 boards: If using Ant1/2/3, the RX signal goes through the TX low-pass
   //                      filters. Therefore we must set these according to the ADC0
   //                      (receive) frequency while RXing, according  to the Max
-  //                      of rx1freq and rx2freq. If TXing, the TX freq governs the LPF
+  //                      of the RX frequencies. If TXing, the TX freq governs the LPF
   //                      in either case.
   //
   LPFfreq = DUCfrequency;
 
   if (!xmit && (device != NEW_DEVICE_ORION2 && device != NEW_DEVICE_SATURN) && receiver[0]->alex_antenna < 3) {
-    LPFfreq = 40000000LL;  // disable the LPF
-
-    if (receiver[0]->adc == 0) {
-      LPFfreq = DDCfrequency[0];
-    }
+    long long maxfreq = -1LL;
 
-    if (receivers > 1) {
-      if (receiver[1]->adc == 0 && DDCfrequency[1] > DDCfrequency[0]) {
-        LPFfreq = DDCfrequency[1];
+    for (int id = 0; id < nrx; id++) {
+      if (receiver[id]->adc == 0 && DDCfrequency[id] > maxfreq) {
+        maxfreq = DDCfrequency[id];
       }
     }
 
+    LPFfreq = (maxfreq < 0LL) ? 40000000LL : maxfreq;  // no RX on ADC0: disable the LPF
+
     if (adc0_filter_bypass) {
       LPFfreq = 40000000LL;   // disable LPF
     }
@@ -1384,6 +1673,10 @@ static void new_protocol_high_priority(void) {
   } else {
     int rc;
 
+    P2CAP_RECORD(P2CAP_TO_RADIO, ntohs(high_priority_addr.sin_port), high_priority_buffer_to_radio, sizeof(high_priority_buffer_to_radio));
+
+    P2TRACE_INSTANT("sendto highprio", ntohs(high_priority_addr.sin_port));
+
     if ((rc = sendto(data_socket, high_priority_buffer_to_radio, sizeof(high_priority_buffer_to_radio), 0,
                      (struct sockaddr * )&high_priority_addr, high_priority_addr_length)) < 0) {
       g_idle_add(fatal_error, "HP send failed (Network down?)");
@@ -1518,6 +1811,10 @@ static void new_protocol_transmit_specific(void) {
   } else {
     int rc;
 
+    P2CAP_RECORD(P2CAP_TO_RADIO, ntohs(transmitter_addr.sin_port), transmit_specific_buffer, sizeof(transmit_specific_buffer));
+
+    P2TRACE_INSTANT("sendto txspec", ntohs(transmitter_addr.sin_port));
+
     if ((rc = sendto(data_socket, transmit_specific_buffer, sizeof(transmit_specific_buffer), 0,
                      (struct sockaddr * )&transmitter_addr, transmitter_addr_length)) < 0) {
       g_idle_add(fatal_error, "TxSpec send failed (Network down?)");
@@ -1536,6 +1833,8 @@ static void new_protocol_transmit_specific(void) {
 static void new_protocol_receive_specific(void) {
   int i;
   int xmit;
+  int nrx;
+  int sddc[MAX_SPECTRUM_RX];
   pthread_mutex_lock(&rx_spec_mutex);
   memset(receive_specific_buffer, 0, sizeof(receive_specific_buffer));
   xmit = radio_is_transmitting();
@@ -1545,13 +1844,11 @@ static void new_protocol_receive_specific(void) {
   receive_specific_buffer[3] = (rx_specific_sequence      ) & 0xFF;
   receive_specific_buffer[4] = n_adc; // number of ADCs
 
-  for (i = 0; i < receivers; i++) {
-    // note that for HERMES, receiver[i] is associated with DDC(i) but beyond
-    // (that is, ANGELIA, ORION, ORION2, G2) receiver[i] is associated with DDC(i+2)
-    int ddc = i;
+  nrx = min(receivers, new_protocol_max_receivers());
 
-    if (device == NEW_DEVICE_ANGELIA  || device == NEW_DEVICE_ORION ||
-        device == NEW_DEVICE_ORION2 || device == NEW_DEVICE_SATURN) { ddc = 2 + i; }
+  for (i = 0; i < nrx; i++) {
+    // see p2_rx_ddc_base() for the association of receivers and DDCs
+    int ddc = p2_rx_ddc_base() + i;
 
     //
     // If there is at least one RX which has the dither or random bit set,
@@ -1562,12 +1859,12 @@ static void new_protocol_receive_specific(void) {
 
     if (!xmit && !diversity_enabled) {
       // normal RX without diversity
-      receive_specific_buffer[7] |= (1 << ddc); // DDC enable
+      receive_specific_buffer[7 + (ddc / 8)] |= (1 << (ddc % 8)); // DDC enable
     }
 
     if (xmit && duplex) {
       // transmitting with duplex
-      receive_specific_buffer[7] |= (1 << ddc); // DDC enable
+      receive_specific_buffer[7 + (ddc / 8)] |= (1 << (ddc % 8)); // DDC enable
     }
 
     receive_specific_buffer[17 + (ddc * 6)] = receiver[i]->adc;
@@ -1576,6 +1873,27 @@ static void new_protocol_receive_specific(void) {
     receive_specific_buffer[22 + (ddc * 6)] = 24;
   }
 
+  //
+  // Spectrum-only receivers are enabled under the same conditions
+  //
+  p2_spectrum_ddcs(sddc);
+
+  for (i = 0; i < MAX_SPECTRUM_RX; i++) {
+    const SPECTRUM_RX *srx = __atomic_load_n(&spectrum_rx[i], __ATOMIC_ACQUIRE);
+    int ddc = sddc[i];
+
+    if (ddc < 0 || srx == NULL) { continue; }
+
+    if ((!xmit && !diversity_enabled) || (xmit && duplex)) {
+      receive_specific_buffer[7 + (ddc / 8)] |= (1 << (ddc % 8)); // DDC enable
+    }
+
+    receive_specific_buffer[17 + (ddc * 6)] = srx->adc;
+    receive_specific_buffer[18 + (ddc * 6)] = ((srx->sample_rate / 1000) >> 8) & 0xFF;
+    receive_specific_buffer[19 + (ddc * 6)] = ((srx->sample_rate / 1000)     ) & 0xFF;
+    receive_specific_buffer[22 + (ddc * 6)] = 24;
+  }
+
   if (transmitter->puresignal && xmit) {
     //
     //    Some things are fixed.
@@ -1628,6 +1946,10 @@ static void new_protocol_receive_specific(void) {
   } else {
     int rc;
 
+    P2CAP_RECORD(P2CAP_TO_RADIO, ntohs(receiver_addr.sin_port), receive_specific_buffer, sizeof(receive_specific_buffer));
+
+    P2TRACE_INSTANT("sendto rxspec", ntohs(receiver_addr.sin_port));
+
     if ((rc = sendto(data_socket, receive_specific_buffer, sizeof(receive_specific_buffer), 0,
                      (struct sockaddr * )&receiver_addr, receiver_addr_length)) < 0) {
       g_idle_add(fatal_error, "RxSpec send failed (Network down?)");
@@ -1703,6 +2025,90 @@ void new_protocol_menu_stop(void) {
   }
 }
 
+//
+// In-place reconfiguration, used when the sample rate or the number of
+// receivers changes. Instead of stopping and re-starting the protocol
+// (which costs about half a second), the caller does
+//
+// new_protocol_reconfigure_begin();
+// ... change receivers, sample rates and WDSP channels ...
+// new_protocol_reconfigure_end();
+//
+// _begin() publishes an action table that skips all DDC packets and
+// waits until no IQ thread is still processing a packet with the old
+// table, so that receivers may be resized or destroyed. There is no
+// timeout: returning while an IQ thread still uses a receiver would
+// let the caller free it under that thread's feet. _end() marks
+// the DDCs whose action, receiver or sample rate changes, publishes
+// the new action table, and sends the new RX-specific and HighPrio
+// packets. The packets of the marked DDCs are discarded for a short
+// time, since they may still have been produced with the old
+// settings. The other DDCs keep running undisturbed.
+//
+static int reconf_ddc_rate(int entry) {
+  switch (RXACTION_CASE(entry)) {
+  case RXACTION_NORMAL:
+  case RXACTION_DIV:
+    return receiver[RXACTION_ID(entry)] ? receiver[RXACTION_ID(entry)]->sample_rate : 0;
+
+  case RXACTION_SPEC:
+    return spectrum_rx[RXACTION_ID(entry)] ? spectrum_rx[RXACTION_ID(entry)]->sample_rate : 0;
+
+  default:
+    return 0;
+  }
+}
+
+void new_protocol_reconfigure_begin(void) {
+  const ACTION_TABLE *table = __atomic_load_n(&action_table, __ATOMIC_ACQUIRE);
+  P2TRACE_BEGIN("p2 reconfigure");
+
+  for (int ddc = 0; ddc < MAX_DDC; ddc++) {
+    reconf_entry[ddc] = table->entry[ddc];
+    reconf_rate[ddc] = reconf_ddc_rate(reconf_entry[ddc]);
+  }
+
+  __atomic_store_n(&p2_reconfiguring, 1, __ATOMIC_RELEASE);
+  update_action_table();
+
+  for (int ddc = 0; ddc < MAX_DDC; ddc++) {
+    int gen = __atomic_load_n(&iq_gen[ddc], __ATOMIC_SEQ_CST);
+
+    //
+    // If the IQ thread is processing a packet, wait until it is done.
+    // Packets started after this point already use the new table.
+    //
+    for (int i = 1; (gen & 1) && __atomic_load_n(&iq_gen[ddc], __ATOMIC_ACQUIRE) == gen; i++) {
+      if (i % 1000 == 0) { t_print("%s: still waiting for DDC%d after %d msec\n", __func__, ddc, i); }
+
+      usleep(1000);
+    }
+  }
+}
+
+void new_protocol_reconfigure_end(void) {
+  int entry[MAX_DDC];
+  uint64_t until = p2m_now() + P2_RECONF_FLUSH_NS;
+  //
+  // The flush deadlines must be in place before the first packet is
+  // processed with the new table, hence the new table is computed
+  // here and only published once the deadlines are set.
+  //
+  action_table_entries(entry, 0);
+
+  for (int ddc = 0; ddc < MAX_DDC; ddc++) {
+    if (entry[ddc] != reconf_entry[ddc] || reconf_ddc_rate(entry[ddc]) != reconf_rate[ddc]) {
+      __atomic_store_n(&iq_flush_until[ddc], until, __ATOMIC_RELEASE);
+    }
+  }
+
+  publish_action_table(entry);
+  __atomic_store_n(&p2_reconfiguring, 0, __ATOMIC_RELEASE);
+  new_protocol_receive_specific();
+  new_protocol_high_priority();
+  P2TRACE_END("p2 reconfigure");
+}
+
 //
 // Function available e.g. to rigctl to (re-) start the new protocol
 //
@@ -1717,8 +2123,6 @@ void new_protocol_menu_start(void) {
   micsamples_sequence = 0;
   audio_sequence = 0;
   tx_iq_sequence = 0;
-  memset(rxcase, 0, sizeof(rxcase));
-  memset(rxid, 0, sizeof(rxid));
   memset(ddc_sequence, 0, sizeof(ddc_sequence));
   update_action_table();
 
@@ -1750,7 +2154,11 @@ void new_protocol_menu_start(void) {
   new_protocol_txiq_thread_id = g_thread_new( "P2 TXIQ", new_protocol_txiq_thread, NULL);
 
   if (!have_saturn_xdma) {
-    new_protocol_thread_id = g_thread_new( "P2 main", new_protocol_thread, NULL);
+    if (p2_replay_file != NULL) {
+      new_protocol_thread_id = g_thread_new( "P2 replay", new_protocol_replay_thread, NULL);
+    } else {
+      new_protocol_thread_id = g_thread_new( "P2 main", new_protocol_thread, NULL);
+    }
   }
 
 #if defined (__APPLE__) && defined (__TAHOEFIX__)
@@ -1820,6 +2228,8 @@ static gpointer new_protocol_rxaudio_thread(gpointer data) {
 
     if (!P2running) { break; }
 
+    uint64_t t0 = p2m_now();
+    P2M_ADD(P2M_RXAUDIO, wakeups, 1);
     nptr = rxaudio_outptr + 256;
 
     if (nptr >= RXAUDIORINGBUFLEN) { nptr = 0; }
@@ -1838,6 +2248,8 @@ static gpointer new_protocol_rxaudio_thread(gpointer data) {
     memcpy(&audiobuffer[4], &RXAUDIORINGBUF[rxaudio_outptr], 256);
     MEMORY_BARRIER;
     rxaudio_outptr = nptr;
+    P2M_ADD(P2M_RXAUDIO, packets, 1);
+    P2M_ADD(P2M_RXAUDIO, busy_ns, p2m_now() - t0);
 
     if (have_saturn_xdma) {
 #ifdef SATURN
@@ -1895,6 +2307,8 @@ static gpointer new_protocol_rxaudio_thread(gpointer data) {
       }
 
       FIFO += 64.0;  // number of samples in THIS packet
+      P2CAP_RECORD(P2CAP_TO_RADIO, ntohs(audio_addr.sin_port), audiobuffer, sizeof(audiobuffer));
+      P2TRACE_INSTANT("sendto audio", ntohs(audio_addr.sin_port));
       int rc = sendto(data_socket, audiobuffer, sizeof(audiobuffer), 0, (struct sockaddr*)&audio_addr, audio_addr_length);
 
       if (rc < 0) {
@@ -1932,6 +2346,8 @@ static gpointer new_protocol_txiq_thread(gpointer data) {
 
     if (!P2running) { break; }
 
+    uint64_t t0 = p2m_now();
+    P2M_ADD(P2M_TXIQ, wakeups, 1);
     iqbuffer[0] = (tx_iq_sequence >> 24) & 0xFF;
     iqbuffer[1] = (tx_iq_sequence >> 16) & 0xFF;
     iqbuffer[2] = (tx_iq_sequence >>  8) & 0xFF;
@@ -1944,6 +2360,8 @@ static gpointer new_protocol_txiq_thread(gpointer data) {
     memcpy(&iqbuffer[4], &TXIQRINGBUF[txiq_outptr], 1440);
     MEMORY_BARRIER;
     txiq_outptr = nptr;
+    P2M_ADD(P2M_TXIQ, packets, 1);
+    P2M_ADD(P2M_TXIQ, busy_ns, p2m_now() - t0);
 
     if (have_saturn_xdma) {
 #ifdef SATURN
@@ -1989,6 +2407,8 @@ static gpointer new_protocol_txiq_thread(gpointer data) {
       }
 
       FIFO += 240.0;  // number of samples in THIS packet
+      P2CAP_RECORD(P2CAP_TO_RADIO, ntohs(iq_addr.sin_port), iqbuffer, sizeof(iqbuffer));
+      P2TRACE_INSTANT("sendto txiq", ntohs(iq_addr.sin_port));
 
       if (sendto(data_socket, iqbuffer, sizeof(iqbuffer), 0, (struct sockaddr * )&iq_addr, iq_addr_length) < 0) {
         g_idle_add(fatal_error, "TX IQ send failed (Network down?)");
@@ -2011,7 +2431,6 @@ static gpointer new_protocol_thread(gpointer data) {
   // (fexchange calls).
   //
   while (P2running) {
-    int ddc;
     short sourceport;
     int bytesread;
     mybuffer *mybuf;
@@ -2037,47 +2456,144 @@ static gpointer new_protocol_thread(gpointer data) {
       break;
     }
 
+    uint64_t t0 = p2m_now();
     sourceport = ntohs(addr.sin_port);
-
+    P2CAP_RECORD(P2CAP_FROM_RADIO, sourceport, buffer, bytesread);
+    P2TRACE_INSTANT("rx packet", sourceport);
     //t_print("new_protocol_thread: recvd %d bytes on port %d\n",bytesread,sourceport);
-    switch (sourceport) {
-    case RX_IQ_TO_HOST_PORT_0:
-    case RX_IQ_TO_HOST_PORT_1:
-    case RX_IQ_TO_HOST_PORT_2:
-    case RX_IQ_TO_HOST_PORT_3:
-    case RX_IQ_TO_HOST_PORT_4:
-    case RX_IQ_TO_HOST_PORT_5:
-    case RX_IQ_TO_HOST_PORT_6:
-    case RX_IQ_TO_HOST_PORT_7:
-      ddc = sourceport - RX_IQ_TO_HOST_PORT_0;
-      saturn_post_iq_data(ddc, mybuf);
-      break;
+    new_protocol_dispatch(sourceport, bytesread, mybuf);
+    P2M_ADD(P2M_MAIN, wakeups, 1);
+    P2M_ADD(P2M_MAIN, packets, 1);
+    P2M_ADD(P2M_MAIN, busy_ns, p2m_now() - t0);
+  }
+
+  return NULL;
+}
+
+static void new_protocol_dispatch(int sourceport, int bytesread, mybuffer *mybuf) {
+  int ddc;
+
+  switch (sourceport) {
+  case RX_IQ_TO_HOST_PORT_0:
+  case RX_IQ_TO_HOST_PORT_1:
+  case RX_IQ_TO_HOST_PORT_2:
+  case RX_IQ_TO_HOST_PORT_3:
+  case RX_IQ_TO_HOST_PORT_4:
+  case RX_IQ_TO_HOST_PORT_5:
+  case RX_IQ_TO_HOST_PORT_6:
+  case RX_IQ_TO_HOST_PORT_7:
+    ddc = sourceport - RX_IQ_TO_HOST_PORT_0;
+    saturn_post_iq_data(ddc, mybuf);
+    break;
+
+  case COMMAND_RESPONSE_TO_HOST_PORT:
+    //
+    // Ignore these packets silently. They occur when
+    // flashing a new firmware using the new protocol
+    // programmer. But this should be done in a separate
+    // program.
+    //
+    mybuf->free = 1;
+    break;
+
+  case HIGH_PRIORITY_TO_HOST_PORT:
+    saturn_post_high_priority(mybuf);
+    break;
+
+  case MIC_LINE_TO_HOST_PORT:
+    saturn_post_micaudio(bytesread, mybuf);
+    break;
+
+  default:
+    RT_PRINT("new_protocol_thread: Unknown port %d\n", sourceport);
+    mybuf->free = 1;
+    break;
+  }
+}
 
-    case COMMAND_RESPONSE_TO_HOST_PORT:
+static gpointer new_protocol_replay_thread(gpointer data) {
+  //
+  // This replaces new_protocol_thread() when replaying a recorded session.
+  // Packets from the radio are fed into the same processing chain as
+  // received packets, either with their original timing or as fast
+  // as the processing threads can take them.
+  //
+  P2CAP_RECORD *rec;
+  struct timespec ts, start;
+  long long first = -1;
+  long count = 0;
+  double elapsed;
+  t_print("%s: file=%s fast=%d\n", __func__, p2_replay_file, p2_replay_fast);
+
+  if (p2cap_open_replay(p2_replay_file) < 0) {
+    g_idle_add(fatal_error, "P2 replay: cannot open capture file");
+    return NULL;
+  }
+
+  rec = g_new(P2CAP_RECORD, 1);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  while (P2running && p2cap_next(rec)) {
+    mybuffer *mybuf;
+
+    if (rec->dir != P2CAP_FROM_RADIO) { continue; }
+
+    if (first < 0) { first = rec->ts; }
+
+    if (p2_replay_fast) {
       //
-      // Ignore these packets silently. They occur when
-      // flashing a new firmware using the new protocol
-      // programmer. But this should be done in a separate
-      // program.
+      // Do not overrun the ring buffers, since this would produce
+      // artificial packet losses.
       //
-      mybuf->free = 1;
-      break;
+      int ddc = rec->port - RX_IQ_TO_HOST_PORT_0;
 
-    case HIGH_PRIORITY_TO_HOST_PORT:
-      saturn_post_high_priority(mybuf);
-      break;
+      if (ddc >= 0 && ddc < MAX_DDC) {
+        for (;;) {
+          int used = iq_inptr[ddc] - iq_outptr[ddc];
 
-    case MIC_LINE_TO_HOST_PORT:
-      saturn_post_micaudio(bytesread, mybuf);
-      break;
+          if (used < 0) { used += RXIQRINGBUFLEN; }
 
-    default:
-      t_print("new_protocol_thread: Unknown port %d\n", sourceport);
-      mybuf->free = 1;
-      break;
+          if (!P2running || used < RXIQRINGBUFLEN / 2) { break; }
+
+          usleep(100);
+        }
+      } else if (rec->port == MIC_LINE_TO_HOST_PORT) {
+        for (;;) {
+          int used = mic_inptr - mic_outptr;
+
+          if (used < 0) { used += MICRINGBUFLEN; }
+
+          if (!P2running || used < MICRINGBUFLEN / 2) { break; }
+
+          usleep(100);
+        }
+      }
+    } else {
+      long long offset = rec->ts - first;
+      ts.tv_sec = start.tv_sec + offset / 1000000000LL;
+      ts.tv_nsec = start.tv_nsec + offset % 1000000000LL;
+
+      if (ts.tv_nsec > 999999999) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+      }
+
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
     }
+
+    if (!P2running) { break; }
+
+    mybuf = get_my_buffer();
+    memcpy(mybuf->buffer, rec->data, rec->len);
+    new_protocol_dispatch(rec->port, rec->len, mybuf);
+    count++;
   }
 
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  elapsed = (ts.tv_sec - start.tv_sec) + 1.0E-9 * (ts.tv_nsec - start.tv_nsec);
+  t_print("%s: %ld packets replayed in %.3f sec\n", __func__, count, elapsed);
+  p2cap_close_replay();
+  g_free(rec);
   return NULL;
 }
 
@@ -2092,8 +2608,14 @@ static gpointer high_priority_thread(gpointer data) {
     sem_post(&high_priority_sem_ready);
     sem_wait(&high_priority_sem_buffer);
 #endif
+    uint64_t t0 = p2m_now();
+    P2TRACE_BEGIN("process_high_priority");
     process_high_priority();
+    P2TRACE_END("process_high_priority");
     high_priority_buffer->free = 1;
+    P2M_ADD(P2M_HP, wakeups, 1);
+    P2M_ADD(P2M_HP, packets, 1);
+    P2M_ADD(P2M_HP, busy_ns, p2m_now() - t0);
   }
 
   return NULL;
@@ -2114,6 +2636,7 @@ static gpointer mic_line_thread(gpointer data) {
 #else
     sem_wait(&mic_line_sem);
 #endif
+    P2M_ADD(P2M_MIC, wakeups, 1);
     nptr = mic_outptr + 1;
 
     if (nptr >= MICRINGBUFLEN) { nptr = 0; }
@@ -2125,8 +2648,13 @@ static gpointer mic_line_thread(gpointer data) {
     // This can happen when restarting the protocol
     if (mybuf->free) { continue; }
 
+    uint64_t t0 = p2m_now();
+    P2TRACE_BEGIN("process_mic_data");
     process_mic_data(mybuf->buffer);
+    P2TRACE_END("process_mic_data");
     mybuf->free = 1;
+    P2M_ADD(P2M_MIC, packets, 1);
+    P2M_ADD(P2M_MIC, busy_ns, p2m_now() - t0);
   }
 
   return NULL;
@@ -2162,6 +2690,7 @@ void saturn_post_micaudio(int bytesread, mybuffer *mybuf) {
   if (mic_count < 0) {
     mic_count++;
     mybuf->free = 1;
+    P2M_ADD(P2M_MIC, overflows, 1);
     return;
   }
 
@@ -2170,6 +2699,11 @@ void saturn_post_micaudio(int bytesread, mybuffer *mybuf) {
   if (nptr >= MICRINGBUFLEN) { nptr = 0; }
 
   if (nptr != mic_outptr) {
+    int used = nptr - mic_outptr;
+
+    if (used < 0) { used += MICRINGBUFLEN; }
+
+    P2M_MAX(P2M_MIC, ring_hwm, used);
     mic_line_buffer[mic_inptr] = mybuf;
     MEMORY_BARRIER;
 #ifdef __APPLE__
@@ -2179,8 +2713,9 @@ void saturn_post_micaudio(int bytesread, mybuffer *mybuf) {
 #endif
     mic_inptr = nptr;
   } else {
-    t_print("%s: buffer overflow.\n", __func__);
+    RT_PRINT("%s: buffer overflow.\n", __func__);
     mybuf->free = 1;
+    P2M_ADD(P2M_MIC, overflows, 1);
     // skip 16 mic buffers (21 msec)
     mic_count = -16;
   }
@@ -2188,7 +2723,7 @@ void saturn_post_micaudio(int bytesread, mybuffer *mybuf) {
 
 void saturn_post_iq_data(int ddc, mybuffer *mybuf) {
   if (ddc < 0 || ddc >= MAX_DDC) {
-    t_print("%s: invalid DDC(%d) seen!\n", __func__, ddc);
+    RT_PRINT("%s: invalid DDC(%d) seen!\n", __func__, ddc);
     mybuf->free = 1;
     return;
   }
@@ -2201,9 +2736,26 @@ void saturn_post_iq_data(int ddc, mybuffer *mybuf) {
   if (iq_count[ddc] < 0) {
     iq_count[ddc]++;
     mybuf->free = 1;
+    P2M_ADD(P2M_DDC0 + ddc, overflows, 1);
     return;
   }
 
+  uint64_t flush_until = __atomic_load_n(&iq_flush_until[ddc], __ATOMIC_ACQUIRE);
+
+  if (flush_until) {
+    //
+    // Packets produced by the radio before a reconfiguration
+    // took effect. Clearing the flush time must not overwrite
+    // one set by a newer reconfiguration.
+    //
+    if (p2m_now() < flush_until) {
+      mybuf->free = 1;
+      return;
+    }
+
+    __atomic_compare_exchange_n(&iq_flush_until[ddc], &flush_until, 0, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+  }
+
   //
   // Check sequence HERE
   //
@@ -2214,8 +2766,9 @@ void saturn_post_iq_data(int ddc, mybuffer *mybuf) {
                            + (buffer[3] & 0xFF);
 
   if (ddc_sequence[ddc] != sequence) {
-    t_print("%s: DDC(%d) sequence error: expected %ld got %ld\n", __func__, ddc, ddc_sequence[ddc], sequence);
+    RT_PRINT("%s: DDC(%d) sequence error: expected %ld got %ld\n", __func__, ddc, ddc_sequence[ddc], sequence);
     sequence_errors++;
+    P2M_ADD(P2M_DDC0 + ddc, seq_errors, 1);
   }
 
   ddc_sequence[ddc] = sequence + 1;
@@ -2225,47 +2778,71 @@ void saturn_post_iq_data(int ddc, mybuffer *mybuf) {
   if (nptr >= RXIQRINGBUFLEN) { nptr = 0; }
 
   if (nptr != iq_outptr[ddc]) {
+    int used = nptr - iq_outptr[ddc];
+
+    if (used < 0) { used += RXIQRINGBUFLEN; }
+
+    P2M_MAX(P2M_DDC0 + ddc, ring_hwm, used);
+    P2TRACE_INSTANT("iq enqueue", ddc);
     iq_buffer[ddc][iptr] = mybuf;
     MEMORY_BARRIER;
-    iq_inptr[ddc] = nptr;
-#ifdef __APPLE__
-    sem_post(iq_sem[ddc]);
-#else
-    sem_post(&iq_sem[ddc]);
-#endif
+    __atomic_store_n(&iq_inptr[ddc], nptr, __ATOMIC_SEQ_CST);
+    iq_schedule(ddc);
   } else {
-    t_print("%s: DDC(%d) buffer overflow.\n", __func__, ddc);
+    RT_PRINT("%s: DDC(%d) buffer overflow.\n", __func__, ddc);
     mybuf->free = 1;
+    P2M_ADD(P2M_DDC0 + ddc, overflows, 1);
     // skip 128 incoming buffers
     iq_count[ddc] = -128;
   }
 }
 
-static gpointer iq_thread(gpointer data) {
-  int ddc = GPOINTER_TO_INT(data);
+static void iq_schedule(int ddc) {
+  int expected = 0;
+  IQ_WORKER *w;
+
   //
-  // TEMPORARY: additional sequence check here
+  // Nothing to do if the DDC is already queued or being processed
   //
+  if (!__atomic_compare_exchange_n(&iq_scheduled[ddc], &expected, 1, FALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+    return;
+  }
+
+  w = &iq_workers[ddc % iq_nworkers];
+  pthread_mutex_lock(&w->mutex);
+  w->queue[(w->head + w->count) % MAX_DDC] = ddc;
+  w->count++;
+  pthread_mutex_unlock(&w->mutex);
+#ifdef __APPLE__
+  sem_post(iq_pool_sem);
+#else
+  sem_post(&iq_pool_sem);
+#endif
+}
+
+static int iq_dequeue(IQ_WORKER *w) {
+  int ddc = -1;
+  pthread_mutex_lock(&w->mutex);
+
+  if (w->count > 0) {
+    ddc = w->queue[w->head];
+    w->head = (w->head + 1) % MAX_DDC;
+    w->count--;
+  }
+
+  pthread_mutex_unlock(&w->mutex);
+  return ddc;
+}
+
+static void iq_process_ddc(int ddc) {
   int nptr, optr;
   long sequence;
-  long expected_sequence = 0;
   volatile mybuffer *mybuf;
   const unsigned char *buffer;
-  t_print("iq_thread: ddc=%d\n", ddc);
+  P2M_ADD(P2M_DDC0 + ddc, wakeups, 1);
 
-  //
-  // At a regular pace, a buffer with 238 samples arrives
-  // every 4960 usec at 48k and every 155 usec at 1536k,
-  // but there may be bursts. Using Diversity the rate
-  // is twice as high since 2 DDCs are packed into one
-  // channel.
-  //
-  while (1) {
-#ifdef __APPLE__
-    sem_wait(iq_sem[ddc]);
-#else
-    sem_wait(&iq_sem[ddc]);
-#endif
+  for (int n = 0; n < IQ_POOL_BATCH && iq_outptr[ddc] != iq_inptr[ddc]; n++) {
+    MEMORY_BARRIER;
     optr = iq_outptr[ddc];
     nptr = optr + 1;
 
@@ -2278,32 +2855,37 @@ static gpointer iq_thread(gpointer data) {
     // This can happen when restarting the protocol
     if (mybuf->free) { continue; }
 
+    uint64_t t0 = p2m_now();
     buffer = (unsigned char *) mybuf->buffer;
     //
     //  TEMP: perform additional sequence check
     //
     sequence = ((buffer[0] & 0xFF) << 24) + ((buffer[1] & 0xFF) << 16) + ((buffer[2] & 0xFF) << 8) + (buffer[3] & 0xFF);
 
-    if (expected_sequence == 0) { expected_sequence = sequence; }
+    if (iq_expected_sequence[ddc] == 0) { iq_expected_sequence[ddc] = sequence; }
 
-    if (sequence != expected_sequence) {
-      t_print("%s: DDC(%d) sequence error: expected %ld got %ld\n", __func__, ddc, expected_sequence, sequence);
+    if (sequence != iq_expected_sequence[ddc]) {
+      RT_PRINT("%s: DDC(%d) sequence error: expected %ld got %ld\n", __func__, ddc, iq_expected_sequence[ddc], sequence);
       sequence_errors++;
     }
 
-    expected_sequence = sequence + 1;
+    iq_expected_sequence[ddc] = sequence + 1;
 
     //
     //  Now comes the action table:
     //  for each DDC we have set up which action to be taken
     //  (and, possibly, for which receiver)
     //
-    switch (rxcase[ddc]) {
+    P2TRACE_BEGIN("process iq");
+    __atomic_add_fetch(&iq_gen[ddc], 1, __ATOMIC_SEQ_CST);
+    int action = __atomic_load_n(&action_table, __ATOMIC_SEQ_CST)->entry[ddc];
+
+    switch (RXACTION_CASE(action)) {
     case RXACTION_SKIP:
       break;
 
     case RXACTION_NORMAL:
-      process_iq_data(buffer, receiver[rxid[ddc]]);
+      process_iq_data(buffer, receiver[RXACTION_ID(action)]);
       break;
 
     case RXACTION_PS:
@@ -2313,21 +2895,97 @@ static gpointer iq_thread(gpointer data) {
     case RXACTION_DIV:
       process_div_iq_data(buffer);
       break;
+
+    case RXACTION_SPEC:
+      process_spectrum_iq_data(buffer, __atomic_load_n(&spectrum_rx[RXACTION_ID(action)], __ATOMIC_ACQUIRE));
+      break;
     }
 
+    __atomic_add_fetch(&iq_gen[ddc], 1, __ATOMIC_RELEASE);
+    P2TRACE_END("process iq");
     mybuf->free = 1;
+    P2M_ADD(P2M_DDC0 + ddc, packets, 1);
+    P2M_ADD(P2M_DDC0 + ddc, busy_ns, p2m_now() - t0);
+  }
+}
+
+static gpointer iq_thread(gpointer data) {
+  int me = GPOINTER_TO_INT(data);
+  int ddc;
+  t_print("iq_thread: worker=%d\n", me);
+
+  //
+  // At a regular pace, a buffer with 238 samples arrives
+  // every 4960 usec at 48k and every 155 usec at 1536k,
+  // but there may be bursts. Using Diversity the rate
+  // is twice as high since 2 DDCs are packed into one
+  // channel.
+  //
+  while (1) {
+#ifdef __APPLE__
+    sem_wait(iq_pool_sem);
+#else
+    sem_wait(&iq_pool_sem);
+#endif
+
+    //
+    // Each post of the semaphore corresponds to a queued DDC, so there
+    // is one for us, either in our own queue or in that of another worker
+    //
+    for (;;) {
+      ddc = iq_dequeue(&iq_workers[me]);
+
+      for (int i = 1; ddc < 0 && i < iq_nworkers; i++) {
+        ddc = iq_dequeue(&iq_workers[(me + i) % iq_nworkers]);
+      }
+
+      if (ddc >= 0) { break; }
+    }
+
+    iq_process_ddc(ddc);
+    __atomic_store_n(&iq_scheduled[ddc], 0, __ATOMIC_SEQ_CST);
+
+    //
+    // Re-schedule if packets are left over (batch limit), or if packets
+    // have arrived after the last check in iq_process_ddc()
+    //
+    if (iq_outptr[ddc] != __atomic_load_n(&iq_inptr[ddc], __ATOMIC_SEQ_CST)) { iq_schedule(ddc); }
   }
 
   return NULL;
 }
 
-static void process_iq_data(const unsigned char *buffer, RECEIVER *rx) {
-  int b;
-  int leftsample;
-  int rightsample;
-  double leftsampledouble;
-  double rightsampledouble;
+//
+// Decode the samples of a DDC packet into a block of (I,Q) pairs,
+// and return the number of samples.
+//
+#define P2_IQ_MAX_SAMPLES 238
+
+static int decode_iq_data(const unsigned char *buffer, double *iq) {
+  int b = 16;
   int samplesperframe = ((buffer[14] & 0xFF) << 8) + (buffer[15] & 0xFF);
+
+  if (samplesperframe > P2_IQ_MAX_SAMPLES) { samplesperframe = P2_IQ_MAX_SAMPLES; }
+
+  for (int i = 0; i < samplesperframe; i++) {
+    int leftsample, rightsample;
+    leftsample   = (int)((signed char) buffer[b++]) << 16;
+    leftsample  |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
+    leftsample  |= (int)((unsigned char)buffer[b++] & 0xFF);
+    rightsample  = (int)((signed char)buffer[b++]) << 16;
+    rightsample |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
+    rightsample |= (int)((unsigned char)buffer[b++] & 0xFF);
+    // The "obscure" constant 1.1920928955078125E-7 is 1/(2^23)
+    iq[2 * i    ] = (double)leftsample * 1.1920928955078125E-7;
+    iq[2 * i + 1] = (double)rightsample * 1.1920928955078125E-7;
+  }
+
+  return samplesperframe;
+}
+
+static void process_iq_data(const unsigned char *buffer, RECEIVER *rx) {
+  double iq[2 * P2_IQ_MAX_SAMPLES];
+  int samplesperframe;
 #ifdef P2IQDEBUG
   long long timestamp =
     ((long long)(buffer[4] & 0xFF) << 56)
@@ -2339,40 +2997,33 @@ static void process_iq_data(const unsigned char *buffer, RECEIVER *rx) {
     + ((long long)(buffer[10] & 0xFF) << 8)
     + ((long long)(buffer[11] & 0xFF)   );
   int bitspersample = ((buffer[12] & 0xFF) << 8) + (buffer[13] & 0xFF);
-  t_print("%s: rx=%d bitspersample=%d samplesperframe=%d\n", __func__, rx->id, bitspersample, samplesperframe);
+  t_print("%s: rx=%d bitspersample=%d samplesperframe=%d\n", __func__, rx->id, bitspersample,
+          ((buffer[14] & 0xFF) << 8) + (buffer[15] & 0xFF));
 #endif
-  b = 16;
-  int i;
+  samplesperframe = decode_iq_data(buffer, iq);
 
-  for (i = 0; i < samplesperframe; i++) {
-    leftsample   = (int)((signed char) buffer[b++]) << 16;
-    leftsample  |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    leftsample  |= (int)((unsigned char)buffer[b++] & 0xFF);
-    rightsample  = (int)((signed char)buffer[b++]) << 16;
-    rightsample |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    rightsample |= (int)((unsigned char)buffer[b++] & 0xFF);
-    // The "obscure" constant 1.1920928955078125E-7 is 1/(2^23)
-    leftsampledouble = (double)leftsample * 1.1920928955078125E-7;
-    rightsampledouble = (double)rightsample * 1.1920928955078125E-7;
-    rx_add_iq_samples(rx, leftsampledouble, rightsampledouble);
+  for (int i = 0; i < samplesperframe; i++) {
+    rx_add_iq_samples(rx, iq[2 * i], iq[2 * i + 1]);
   }
 }
 
-//
-// This is the same as process_ps_iq_data except that add_div_iq_samples is called
-// at the end
-//
+static void process_spectrum_iq_data(const unsigned char *buffer, SPECTRUM_RX *srx) {
+  double iq[2 * P2_IQ_MAX_SAMPLES];
+  int samplesperframe;
+
+  if (srx == NULL) { return; }
+
+  samplesperframe = decode_iq_data(buffer, iq);
+  spectrum_rx_add_iq_samples(srx, iq, samplesperframe);
+}
+
 static void process_div_iq_data(const unsigned char*buffer) {
-  int b;
-  int leftsample0;
-  int rightsample0;
-  double leftsampledouble0;
-  double rightsampledouble0;
-  int leftsample1;
-  int rightsample1;
-  double leftsampledouble1;
-  double rightsampledouble1;
-  int samplesperframe = ((buffer[14] & 0xFF) << 8) + (buffer[15] & 0xFF);
+  double iq[2 * P2_IQ_MAX_SAMPLES];
+  double iq0[P2_IQ_MAX_SAMPLES];
+  double iq1[P2_IQ_MAX_SAMPLES];
+  double out[P2_IQ_MAX_SAMPLES];
+  int samplesperframe;
+  int n;
 #ifdef P2IQDEBUG
   long long timestamp =
     ((long long)(buffer[4] & 0xFF) << 56)
@@ -2384,35 +3035,35 @@ static void process_div_iq_data(const unsigned char*buffer) {
     + ((long long)(buffer[10] & 0xFF) << 8)
     + ((long long)(buffer[11] & 0xFF)    );
   int bitspersample = ((buffer[12] & 0xFF) << 8) + (buffer[13] & 0xFF);
-  t_print("%s: rx=%d bitspersample=%d samplesperframe=%d\n", __func__, rx->id, bitspersample, samplesperframe);
+  t_print("%s: bitspersample=%d samplesperframe=%d\n", __func__, bitspersample,
+          ((buffer[14] & 0xFF) << 8) + (buffer[15] & 0xFF));
 #endif
-  b = 16;
-  int i;
+  //
+  // The samples of DDC0 (ADC0) and DDC1 (ADC1) alternate in the packet.
+  // Decode and de-interleave the whole frame, then combine it in one go.
+  //
+  samplesperframe = decode_iq_data(buffer, iq);
+  n = samplesperframe / 2;
 
-  for (i = 0; i < samplesperframe; i += 2) {
-    leftsample0   = (int)((signed char) buffer[b++]) << 16;
-    leftsample0  |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    leftsample0  |= (int)((unsigned char)buffer[b++] & 0xFF);
-    rightsample0  = (int)((signed char)buffer[b++]) << 16;
-    rightsample0 |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    rightsample0 |= (int)((unsigned char)buffer[b++] & 0xFF);
-    leftsampledouble0 = (double)leftsample0 * 1.1920928955078125E-7;
-    rightsampledouble0 = (double)rightsample0 * 1.1920928955078125E-7;
-    leftsample1   = (int)((signed char) buffer[b++]) << 16;
-    leftsample1  |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    leftsample1  |= (int)((unsigned char)buffer[b++] & 0xFF);
-    rightsample1  = (int)((signed char)buffer[b++]) << 16;
-    rightsample1 |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    rightsample1 |= (int)((unsigned char)buffer[b++] & 0xFF);
-    leftsampledouble1 = (double)leftsample1 * 1.1920928955078125E-7;
-    rightsampledouble1 = (double)rightsample1 * 1.1920928955078125E-7;
-    rx_add_div_iq_samples(receiver[0], leftsampledouble0, rightsampledouble0, leftsampledouble1, rightsampledouble1);
+  for (int i = 0; i < n; i++) {
+    iq0[2 * i]     = iq[4 * i];
+    iq0[2 * i + 1] = iq[4 * i + 1];
+    iq1[2 * i]     = iq[4 * i + 2];
+    iq1[2 * i + 1] = iq[4 * i + 3];
+  }
 
-    //
-    // if both receivers share the sample rate, we can feed data to RX2
-    //
-    if (receivers > 1 && (receiver[0]->sample_rate == receiver[1]->sample_rate)) {
-      rx_add_iq_samples(receiver[1], leftsampledouble1, rightsampledouble1);
+  divcomb_process(iq0, iq1, out, n, receiver[0]->sample_rate);
+
+  for (int i = 0; i < n; i++) {
+    rx_add_iq_samples(receiver[0], out[2 * i], out[2 * i + 1]);
+  }
+
+  //
+  // if both receivers share the sample rate, we can feed data to RX2
+  //
+  if (receivers > 1 && (receiver[0]->sample_rate == receiver[1]->sample_rate)) {
+    for (int i = 0; i < n; i++) {
+      rx_add_iq_samples(receiver[1], iq1[2 * i], iq1[2 * i + 1]);
     }
   }
 }
@@ -2503,9 +3154,10 @@ static void process_high_priority(void) {
   sequence = ((buffer[0] & 0xFF) << 24) + ((buffer[1] & 0xFF) << 16) + ((buffer[2] & 0xFF) << 8) + (buffer[3] & 0xFF);
 
   if (sequence != highprio_rcvd_sequence) {
-    t_print("HighPrio SeqErr Expected=%ld Seen=%ld\n", highprio_rcvd_sequence, sequence);
+    RT_PRINT("HighPrio SeqErr Expected=%ld Seen=%ld\n", highprio_rcvd_sequence, sequence);
     highprio_rcvd_sequence = sequence;
     sequence_errors++;
+    P2M_ADD(P2M_HP, seq_errors, 1);
   }
 
   highprio_rcvd_sequence++;
@@ -2588,7 +3240,7 @@ static void process_high_priority(void) {
   }
 
   if (previous_ptt != radio_ptt) {
-    g_idle_add(ext_mox_update, GINT_TO_POINTER(radio_ptt));
+    P2TRACE_IDLE_ADD(ext_mox_update, GINT_TO_POINTER(radio_ptt));
   }
 
   if (enable_tx_inhibit) {
@@ -2600,7 +3252,7 @@ static void process_high_priority(void) {
 
     if (!TxInhibit && data == 0) {
       TxInhibit = 1;
-      g_idle_add(ext_mox_update, GINT_TO_POINTER(0));
+      P2TRACE_IDLE_ADD(ext_mox_update, GINT_TO_POINTER(0));
     }
 
     if (data == 1) { TxInhibit = 0; }
@@ -2628,8 +3280,9 @@ static void process_mic_data(const unsigned char *buffer) {
   sequence = ((buffer[0] & 0xFF) << 24) + ((buffer[1] & 0xFF) << 16) + ((buffer[2] & 0xFF) << 8) + (buffer[3] & 0xFF);
 
   if (sequence != micsamples_sequence) {
-    t_print("MicSample SeqErr Expected=%ld Seen=%ld\n", micsamples_sequence, sequence);
+    RT_PRINT("MicSample SeqErr Expected=%ld Seen=%ld\n", micsamples_sequence, sequence);
     sequence_errors++;
+    P2M_ADD(P2M_MIC, seq_errors, 1);
   }
 
   micsamples_sequence = sequence + 1;
@@ -2699,6 +3352,11 @@ void new_protocol_cw_audio_samples(short left_audio_sample, short right_audio_sa
       if (nptr >= RXAUDIORINGBUFLEN) { nptr = 0; }
 
       if (nptr != rxaudio_outptr) {
+        int used = nptr - rxaudio_outptr;
+
+        if (used < 0) { used += RXAUDIORINGBUFLEN; }
+
+        P2M_MAX(P2M_RXAUDIO, ring_hwm, used / 256);
         rxaudio_inptr = nptr;
 #ifdef __APPLE__
         sem_post(rxaudio_sem);
@@ -2707,9 +3365,10 @@ void new_protocol_cw_audio_samples(short left_audio_sample, short right_audio_sa
 #endif
         rxaudio_count = 0;
       } else {
-        t_print("%s: buffer overflow\n", __func__);
+        RT_PRINT("%s: buffer overflow\n", __func__);
         // skip some audio samples
         rxaudio_count = -4096;
+        P2M_ADD(P2M_RXAUDIO, overflows, 1);
       }
     }
 
@@ -2756,6 +3415,11 @@ void new_protocol_audio_samples(short left_audio_sample, short right_audio_sampl
     if (nptr >= RXAUDIORINGBUFLEN) { nptr = 0; }
 
     if (nptr != rxaudio_outptr) {
+      int used = nptr - rxaudio_outptr;
+
+      if (used < 0) { used += RXAUDIORINGBUFLEN; }
+
+      P2M_MAX(P2M_RXAUDIO, ring_hwm, used / 256);
       rxaudio_inptr = nptr;
 #ifdef __APPLE__
       sem_post(rxaudio_sem);
@@ -2764,9 +3428,10 @@ void new_protocol_audio_samples(short left_audio_sample, short right_audio_sampl
 #endif
       rxaudio_count = 0;
     } else {
-      t_print("%s: buffer overflow\n", __func__);
+      RT_PRINT("%s: buffer overflow\n", __func__);
       // skip some audio samples
       rxaudio_count = -4096;
+      P2M_ADD(P2M_RXAUDIO, overflows, 1);
     }
   }
 
@@ -2803,6 +3468,11 @@ void new_protocol_iq_samples(int isample, int qsample) {
     if (nptr >= TXIQRINGBUFLEN) { nptr = 0; }
 
     if (nptr != txiq_outptr) {
+      int used = nptr - txiq_outptr;
+
+      if (used < 0) { used += TXIQRINGBUFLEN; }
+
+      P2M_MAX(P2M_TXIQ, ring_hwm, used / 1440);
       txiq_inptr = nptr;
       txiq_count = 0;
 #ifdef __APPLE__
@@ -2811,9 +3481,10 @@ void new_protocol_iq_samples(int isample, int qsample) {
       sem_post(&txiq_sem);
 #endif
     } else {
-      t_print("%s: output buffer overflow\n", __func__);
+      RT_PRINT("%s: output buffer overflow\n", __func__);
       // skip 4800 samples ( 25 msec @ 192k )
       txiq_count = -4800;
+      P2M_ADD(P2M_TXIQ, overflows, 1);
     }
   }
 }
@@ -2842,6 +3513,7 @@ void* new_protocol_timer_thread(void* arg) {
   usleep(100000);                               // wait for things to settle down
 
   while (P2running) {
+    uint64_t t0 = p2m_now();
     cycling++;
 
     switch (cycling) {
@@ -2851,6 +3523,7 @@ void* new_protocol_timer_thread(void* arg) {
     case 7:
       new_protocol_high_priority();           // every 100 msec
       new_protocol_transmit_specific();       // every 200 msec
+      P2M_ADD(P2M_TIMER, packets, 2);
       break;
 
     case 2:
@@ -2858,16 +3531,21 @@ void* new_protocol_timer_thread(void* arg) {
     case 6:
       new_protocol_high_priority();           // every 100 msec
       new_protocol_receive_specific();        // every 200 msec
+      P2M_ADD(P2M_TIMER, packets, 2);
       break;
 
     case 8:
       new_protocol_high_priority();           // every 100 msec
       new_protocol_receive_specific();        // every 200 msec
       new_protocol_general();                 // every 800 msec
+      P2M_ADD(P2M_TIMER, packets, 3);
       cycling = 0;
       break;
     }
 
+    P2M_ADD(P2M_TIMER, wakeups, 1);
+    P2M_ADD(P2M_TIMER, busy_ns, p2m_now() - t0);
+
     usleep(100000);
   }
 
@@ -0,0 +1,613 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// p2bench: micro-benchmarks for the protocol 2 and VFO hot paths
+//
+// This program drives, with synthetic data and without any radio,
+// network or display, the following kernels:
+//
+// - process_iq_data(), process_div_iq_data(), process_ps_iq_data()
+// - new_protocol_iq_samples(), new_protocol_audio_samples()
+// - get_my_buffer()
+// - new_protocol_high_priority() (packet building only)
+// - get_band_from_frequency()
+// - props lookups by name, linear list vs. hash index (PROP_INDEX)
+// - vfo_render() (the drawing part of vfo_update(), into an off-screen image surface)
+//
+// Since most of these are static, new_protocol.c and vfo.c are compiled
+// into this file ("unity build"). Before doing so, sendto() and the
+// functions that hand over samples to WDSP are redirected to counting
+// sinks, so that only the code in new_protocol.c/vfo.c is measured.
+// p2bench is linked with all other deskHPSDR objects except main.o,
+// new_protocol.o and vfo.o, for example with a Makefile rule like
+//
+// p2bench: p2bench.o $(filter-out main.o new_protocol.o vfo.o,$(OBJS))
+//         $(LINK) -o p2bench $^ $(LIBS)
+//
+// For each benchmark, the time per operation, the throughput and the
+// number of allocations per operation are reported. With the -j option,
+// the results are written as JSON to allow comparing different builds.
+//
+// Allocations are counted (with glibc only) by defining malloc(), calloc()
+// and realloc() in p2bench itself. These take precedence over those of
+// libc for all shared libraries as well, so allocations made through
+// g_malloc() or by cairo are counted, too. They forward to glibc's
+// __libc_malloc() etc. The bytes/op figure is the number of bytes
+// requested, so memory that is freed again within the operation is
+// counted as well. Without glibc, the allocation columns are empty.
+//
+// Usage: p2bench [-j] [-t seconds] [-f filter]
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <gtk/gtk.h>
+
+//
+// Include all system headers used by new_protocol.c and vfo.c *before*
+// the redirections below are defined.
+//
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/utsname.h>
+
+#include "main.h"
+#include "receiver.h"
+#include "transmitter.h"
+#include "radio.h"
+#include "band.h"
+#include "message.h"
+#include "propindex.h"
+
+//
+// Counting sinks. These replace the functions that would normally
+// pass data to WDSP or to the network.
+//
+static long   bench_sent = 0;
+static double bench_sink = 0.0;
+
+static ssize_t bench_sendto(int s, const void *buf, size_t len, int flags, const struct sockaddr *to, socklen_t tolen) {
+  bench_sent += len;
+  return len;
+}
+
+static void bench_rx_add_iq_samples(RECEIVER *rx, double i, double q) {
+  bench_sink += i + q;
+}
+
+static void bench_rx_add_div_iq_samples(RECEIVER *rx, double i0, double q0, double i1, double q1) {
+  bench_sink += i0 + q0 + i1 + q1;
+}
+
+static void bench_tx_add_ps_iq_samples(TRANSMITTER *tx, double i1, double q1, double i0, double q0) {
+  bench_sink += i0 + q0 + i1 + q1;
+}
+
+#define sendto                bench_sendto
+#define rx_add_iq_samples     bench_rx_add_iq_samples
+#define rx_add_div_iq_samples bench_rx_add_div_iq_samples
+#define tx_add_ps_iq_samples  bench_tx_add_ps_iq_samples
+
+#include "new_protocol.c"
+#include "vfo.c"
+
+#undef sendto
+
+//
+// Symbols normally provided by main.c
+//
+struct utsname unameData;
+GdkScreen *screen;
+int display_width = 1280;
+int display_height = 600;
+int screen_height = 600;
+int screen_width = 1280;
+int full_screen = 0;
+int this_monitor = 0;
+int use_wayland = 0;
+GtkWidget *top_window = NULL;
+GtkWidget *topgrid = NULL;
+pthread_t deskhpsdr_main_thread;
+
+void status_text(const char *text) {
+}
+
+const char* get_current_gtk_theme(void) {
+  return "Adwaita";
+}
+
+gboolean is_theme_adwaita(void) {
+  return TRUE;
+}
+
+gboolean keypress_cb(GtkWidget *widget, GdkEventKey *event, gpointer data) {
+  return FALSE;
+}
+
+gboolean main_delete (GtkWidget *widget) {
+  _exit(0);
+}
+
+int fatal_error(void *data) {
+  t_print("%s: %s\n", __func__, (const char *) data);
+  return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Benchmark driver
+//
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct _bench {
+  const char *name;
+  void (*setup)(void);
+  void (*run)(long n);          // perform n operations
+  int bytes_per_op;             // for throughput, zero if not applicable
+  const char *unit;             // what one operation is
+} BENCH;
+
+static int json = 0;
+static double min_time = 0.5;
+static const char *filter = NULL;
+
+static unsigned char ddc_packet[1444];
+static long long freq_table[4096];
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1.0E-9 * ts.tv_nsec;
+}
+
+//
+// Allocation counters (see above)
+//
+static long bench_allocs = 0;
+static long bench_alloc_bytes = 0;
+
+#if defined(__GLIBC__)
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) {
+  __atomic_add_fetch(&bench_allocs, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&bench_alloc_bytes, (long) size, __ATOMIC_RELAXED);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+  __atomic_add_fetch(&bench_allocs, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&bench_alloc_bytes, (long)(nmemb * size), __ATOMIC_RELAXED);
+  return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  __atomic_add_fetch(&bench_allocs, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&bench_alloc_bytes, (long) size, __ATOMIC_RELAXED);
+  return __libc_realloc(ptr, size);
+}
+
+  #define BENCH_COUNT_ALLOCS 1
+#else
+  #define BENCH_COUNT_ALLOCS 0
+#endif
+
+//
+// A DDC packet with 238 random 24-bit samples
+//
+static void setup_ddc_packet(void) {
+  unsigned int seed = 4711;
+  memset(ddc_packet, 0, sizeof(ddc_packet));
+  ddc_packet[13] = 24;   // bits per sample
+  ddc_packet[14] = 0;
+  ddc_packet[15] = 238;  // samples per frame
+
+  for (int i = 16; i < 1444; i++) {
+    ddc_packet[i] = rand_r(&seed) & 0xFF;
+  }
+}
+
+static void run_process_iq_data(long n) {
+  for (long i = 0; i < n; i++) {
+    process_iq_data(ddc_packet, receiver[0]);
+  }
+}
+
+static void run_process_div_iq_data(long n) {
+  for (long i = 0; i < n; i++) {
+    process_div_iq_data(ddc_packet);
+  }
+}
+
+static void run_process_ps_iq_data(long n) {
+  for (long i = 0; i < n; i++) {
+    process_ps_iq_data(ddc_packet);
+  }
+}
+
+//
+// For the TX IQ and RX audio ring buffers, emulate the consumer
+// thread by emptying the ring buffer after each packet.
+//
+static void run_new_protocol_iq_samples(long n) {
+  for (long i = 0; i < n; i++) {
+    new_protocol_iq_samples((int)(i * 4099) & 0x7FFFFF, (int)(i * 8191) & 0x7FFFFF);
+
+    if (txiq_count == 0) {
+      txiq_outptr = txiq_inptr;
+#ifdef __APPLE__
+      sem_trywait(txiq_sem);
+#else
+      sem_trywait(&txiq_sem);
+#endif
+    }
+  }
+}
+
+static void run_new_protocol_audio_samples(long n) {
+  for (long i = 0; i < n; i++) {
+    new_protocol_audio_samples((short)(i * 31), (short)(i * 37));
+
+    if (rxaudio_count == 0) {
+      rxaudio_outptr = rxaudio_inptr;
+#ifdef __APPLE__
+      sem_trywait(rxaudio_sem);
+#else
+      sem_trywait(&rxaudio_sem);
+#endif
+    }
+  }
+}
+
+//
+// Keep 64 buffers "in flight", as it happens if the IQ threads
+// lag a little behind
+//
+#define BENCH_INFLIGHT 64
+
+static void run_get_my_buffer(long n) {
+  static mybuffer *inflight[BENCH_INFLIGHT];
+  static int ptr = 0;
+
+  for (long i = 0; i < n; i++) {
+    if (inflight[ptr]) { inflight[ptr]->free = 1; }
+
+    inflight[ptr] = get_my_buffer();
+    ptr = (ptr + 1) % BENCH_INFLIGHT;
+  }
+}
+
+static void run_new_protocol_high_priority(long n) {
+  for (long i = 0; i < n; i++) {
+    vfo[0].frequency = 14000000LL + (i & 0xFFFF);
+    new_protocol_high_priority();
+  }
+}
+
+static void setup_freq_table(void) {
+  unsigned int seed = 815;
+
+  for (int i = 0; i < 4096; i++) {
+    freq_table[i] = (long long)(rand_r(&seed) % 60000000);
+  }
+}
+
+static void run_get_band_from_frequency(long n) {
+  int sum = 0;
+
+  for (long i = 0; i < n; i++) {
+    sum += get_band_from_frequency(freq_table[i & 4095]);
+  }
+
+  bench_sink += sum;
+}
+
+static void setup_vfo_surface(void) {
+  //
+  // There is no render thread, so vfo_render() draws synchronously
+  // into image surfaces of this size
+  //
+  if (vfo_surface_width == 0) {
+    my_width = 800;
+    my_height = 80;
+    vfo_surface_width = my_width;
+    vfo_surface_height = my_height;
+  }
+}
+
+static void run_vfo_update(long n) {
+  for (long i = 0; i < n; i++) {
+    vfo[0].frequency = 14074000LL + 10 * (i & 0xFF);
+    vfo_render();
+  }
+}
+
+//
+// A props file as written with all bands and transverter bands
+// populated: the band and bandstack keys, the mode settings, and
+// some other keys. The keys are looked up in the order in which
+// bandRestoreState() and modesettingsRestoreState() ask for them.
+//
+static char **prop_names = NULL;
+static int num_props = 0;
+static PROP_INDEX *prop_index = NULL;
+
+static void prop_add(const char *name) {
+  if ((num_props & 1023) == 0) { prop_names = g_renew(char *, prop_names, num_props + 1024); }
+
+  prop_names[num_props++] = g_strdup(name);
+}
+
+static void setup_props(void) {
+  static const char *band_keys[] = {"title", "frequencyLO", "errorLO", "gain", "frequencyMin", "frequencyMax",
+                                    "disablePA", "current", "alexRxAntenna", "alexTxAntenna", "alexAttenuation",
+                                    "pa_calibration", "OCrx", "OCtx"
+                                   };
+  static const char *stack_keys[] = {"a", "mode", "filter", "ctun", "c", "deviation", "ctcss_enabled", "ctcss"};
+  static const char *eq_keys[] = {"txeq", "txeqfrq", "rxeq", "rxeqfrq", "cfc_frq", "cfc_lvl", "cfc_post"};
+  char name[64];
+
+  if (prop_index) { return; }
+
+  for (int i = 0; i < 500; i++) {
+    snprintf(name, sizeof(name), "receiver.%d.setting%d", i & 7, i);
+    prop_add(name);
+  }
+
+  for (int b = 0; b < BANDS + XVTRS; b++) {
+    for (int k = 0; k < (int)(sizeof(band_keys) / sizeof(band_keys[0])); k++) {
+      snprintf(name, sizeof(name), "band.%d.%s", b, band_keys[k]);
+      prop_add(name);
+    }
+
+    for (int st = 0; st < 6; st++) {
+      for (int k = 0; k < (int)(sizeof(stack_keys) / sizeof(stack_keys[0])); k++) {
+        snprintf(name, sizeof(name), "band.%d.stack.%d.%s", b, st, stack_keys[k]);
+        prop_add(name);
+      }
+    }
+  }
+
+  for (int m = 0; m < MODES; m++) {
+    for (int k = 0; k < 60; k++) {
+      snprintf(name, sizeof(name), "modeset.%d.field%d", m, k);
+      prop_add(name);
+    }
+
+    for (int j = 0; j < 13; j++) {
+      for (int k = 0; k < (int)(sizeof(eq_keys) / sizeof(eq_keys[0])); k++) {
+        snprintf(name, sizeof(name), "modeset.%d.%s.%d", m, eq_keys[k], j);
+        prop_add(name);
+      }
+    }
+  }
+
+  prop_index = prop_index_new(num_props);
+
+  for (int i = 0; i < num_props; i++) {
+    prop_index_set(prop_index, prop_names[i], "1");
+  }
+
+  t_print("%s: %d props\n", __func__, num_props);
+}
+
+static void run_props_lookup_list(long n) {
+  for (long i = 0; i < n; i++) {
+    const char *name = prop_names[i % num_props];
+
+    for (int k = 0; k < num_props; k++) {
+      if (!strcmp(prop_names[k], name)) {
+        bench_sink += k;
+        break;
+      }
+    }
+  }
+}
+
+static void run_props_lookup_hash(long n) {
+  for (long i = 0; i < n; i++) {
+    bench_sink += *prop_index_get(prop_index, prop_names[i % num_props]);
+  }
+}
+
+static BENCH benches[] = {
+  {"process_iq_data",            setup_ddc_packet,  run_process_iq_data,            1444, "packet"},
+  {"process_div_iq_data",        setup_ddc_packet,  run_process_div_iq_data,        1444, "packet"},
+  {"process_ps_iq_data",         setup_ddc_packet,  run_process_ps_iq_data,         1444, "packet"},
+  {"new_protocol_iq_samples",    NULL,              run_new_protocol_iq_samples,       6, "sample"},
+  {"new_protocol_audio_samples", NULL,              run_new_protocol_audio_samples,    4, "sample"},
+  {"get_my_buffer",              NULL,              run_get_my_buffer,                 0, "buffer"},
+  {"new_protocol_high_priority", NULL,              run_new_protocol_high_priority, 1444, "packet"},
+  {"get_band_from_frequency",    setup_freq_table,  run_get_band_from_frequency,       0, "lookup"},
+  {"vfo_update",                 setup_vfo_surface, run_vfo_update,                    0, "frame"},
+  {"props_lookup_list",          setup_props,       run_props_lookup_list,             0, "lookup"},
+  {"props_lookup_hash",          setup_props,       run_props_lookup_hash,             0, "lookup"},
+};
+
+#define NUM_BENCHES (int)(sizeof(benches) / sizeof(benches[0]))
+
+static DISCOVERED bench_discovered;
+
+static void bench_setup_radio(void) {
+  //
+  // Create a minimal radio state: two receivers and a transmitter
+  // with everything zeroed, VFO A on 20m and VFO B on 40m.
+  //
+  for (int i = 0; i < 2; i++) {
+    receiver[i] = g_new0(RECEIVER, 1);
+    receiver[i]->id = i;
+    receiver[i]->sample_rate = 48000;
+    receiver[i]->filter_low = 150;
+    receiver[i]->filter_high = 2850;
+  }
+
+  receivers = 2;
+  active_receiver = receiver[0];
+  transmitter = g_new0(TRANSMITTER, 1);
+  bench_discovered.frequency_min = 0LL;
+  bench_discovered.frequency_max = 61440000LL;
+  radio = &bench_discovered;
+  band_init();
+  vfo[0].frequency = 14074000LL;
+  vfo[0].band = get_band_from_frequency(vfo[0].frequency);
+  vfo[0].mode = modeUSB;
+  vfo[1].frequency = 7074000LL;
+  vfo[1].band = get_band_from_frequency(vfo[1].frequency);
+  vfo[1].mode = modeLSB;
+  data_socket = 0;     // sendto() goes to bench_sendto()
+  p2metrics_init();
+  TXIQRINGBUF = g_new(unsigned char, TXIQRINGBUFLEN);
+  RXAUDIORINGBUF = g_new(unsigned char, RXAUDIORINGBUFLEN);
+#ifdef __APPLE__
+  txiq_sem = apple_sem(0);
+  rxaudio_sem = apple_sem(0);
+#else
+  (void)sem_init(&txiq_sem, 0, 0);
+  (void)sem_init(&rxaudio_sem, 0, 0);
+#endif
+}
+
+static void bench_one(const BENCH *b, int first) {
+  long n = 1;
+  double t0, t;
+  long allocs, bytes;
+
+  if (b->setup) { b->setup(); }
+
+  //
+  // warm-up and calibration: double n until the run takes
+  // at least 1/10 of the requested time
+  //
+  for (;;) {
+    t0 = bench_now();
+    b->run(n);
+    t = bench_now() - t0;
+
+    if (t >= 0.1 * min_time || n > (1L << 40)) { break; }
+
+    n *= 2;
+  }
+
+  n = (long)(n * min_time / (t > 1.0E-9 ? t : 1.0E-9));
+
+  if (n < 1) { n = 1; }
+
+  allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+  bytes = __atomic_load_n(&bench_alloc_bytes, __ATOMIC_RELAXED);
+  t0 = bench_now();
+  b->run(n);
+  t = bench_now() - t0;
+  allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED) - allocs;
+  bytes = __atomic_load_n(&bench_alloc_bytes, __ATOMIC_RELAXED) - bytes;
+  double ns = 1.0E9 * t / n;
+  double ops = n / t;
+  double mbs = b->bytes_per_op * ops * 1.0E-6;
+
+  if (json) {
+    printf("%s\n    {\"name\": \"%s\", \"unit\": \"%s\", \"iterations\": %ld, \"ns_per_op\": %.3f, "
+           "\"ops_per_sec\": %.1f, \"mb_per_sec\": %.3f",
+           first ? "" : ",", b->name, b->unit, n, ns, ops, mbs);
+
+    if (BENCH_COUNT_ALLOCS) {
+      printf(", \"allocs_per_op\": %.6f, \"bytes_per_op\": %.3f}", (double) allocs / n, (double) bytes / n);
+    } else {
+      printf(", \"allocs_per_op\": null, \"bytes_per_op\": null}");
+    }
+  } else if (BENCH_COUNT_ALLOCS) {
+    printf("%-28s %12ld %12.1f %14.0f %10.2f %10.4f %10.1f\n",
+           b->name, n, ns, ops, mbs, (double) allocs / n, (double) bytes / n);
+  } else {
+    printf("%-28s %12ld %12.1f %14.0f %10.2f %10s %10s\n", b->name, n, ns, ops, mbs, "-", "-");
+  }
+
+  fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+  int c;
+  int first = 1;
+
+  while ((c = getopt(argc, argv, "jt:f:")) != -1) {
+    switch (c) {
+    case 'j':
+      json = 1;
+      break;
+
+    case 't':
+      min_time = atof(optarg);
+
+      if (min_time <= 0.0) { min_time = 0.5; }
+
+      break;
+
+    case 'f':
+      filter = optarg;
+      break;
+
+    default:
+      fprintf(stderr, "Usage: %s [-j] [-t seconds] [-f filter]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  uname(&unameData);
+  bench_setup_radio();
+
+  if (json) {
+    printf("{\n  \"compiler\": \"%s\",\n  \"machine\": \"%s\",\n  \"min_time\": %.3f,\n  \"results\": [",
+           __VERSION__, unameData.machine, min_time);
+  } else {
+    printf("%-28s %12s %12s %14s %10s %10s %10s\n",
+           "benchmark", "iterations", "ns/op", "ops/s", "MB/s", "allocs/op", "bytes/op");
+  }
+
+  for (int i = 0; i < NUM_BENCHES; i++) {
+    if (filter && strstr(benches[i].name, filter) == NULL) { continue; }
+
+    bench_one(&benches[i], first);
+    first = 0;
+  }
+
+  if (json) {
+    printf("\n  ],\n  \"sink\": %g,\n  \"sent\": %ld\n}\n", bench_sink, bench_sent);
+  }
+
+  return 0;
+}
@@ -0,0 +1,383 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Recording and replay of protocol 2 sessions
+//
+// File format (all numbers in host byte order):
+//
+// File header (16 bytes):
+//   "P2CAP\0"     magic
+//   uint16        version
+//   uint64        reserved
+//
+// Each record:
+//   int64         time stamp (nsec since start of recording)
+//   uint16        port
+//   uint8         direction (0: from radio, 1: to radio)
+//   uint8         reserved
+//   uint16        length of data
+//   data
+//
+// At the end of the file, there is an index which contains the file
+// offset of the first record in each second of the recording:
+//   int64[n]      file offsets
+//   "P2IDX\0"     magic
+//   uint16        reserved
+//   uint64        n (number of index entries)
+//
+// The index is only written when the recording is stopped properly.
+// Files without index can be replayed but not positioned.
+//
+// The packets are not written to the file by the threads that receive
+// or send them. Instead, they are copied into a large ring buffer
+// from which a low-priority writer thread transfers them to the file.
+// If the ring buffer is full, packets are dropped (and counted).
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <gtk/gtk.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "p2capture.h"
+#include "message.h"
+
+#define P2CAP_VERSION     1
+#define P2CAP_HDRLEN     16
+#define P2CAP_RECHDRLEN  14
+#define P2CAP_RINGLEN    (16 * 1024 * 1024)
+
+volatile int p2cap_recording = 0;
+
+//
+// The fields in the file headers are not aligned, so they are
+// accessed with memcpy() (in host byte order)
+//
+static inline void put_u16(unsigned char *p, uint16_t v) { memcpy(p, &v, sizeof(v)); }
+static inline void put_u64(unsigned char *p, uint64_t v) { memcpy(p, &v, sizeof(v)); }
+static inline void put_i64(unsigned char *p, int64_t v)  { memcpy(p, &v, sizeof(v)); }
+
+static inline uint16_t get_u16(const unsigned char *p) {
+  uint16_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint64_t get_u64(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline int64_t get_i64(const unsigned char *p) {
+  int64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static FILE *rec_file = NULL;
+static unsigned char *rec_ring = NULL;
+static volatile int rec_inptr = 0;     // updated by p2cap_record()
+static volatile int rec_outptr = 0;    // updated by the writer thread
+static long long rec_produced = 0;     // number of bytes put into the ring buffer
+static long long rec_start = 0;
+static long rec_dropped = 0;
+static long rec_count = 0;
+static GMutex rec_mutex;
+static GThread *rec_thread_id = NULL;
+static volatile int rec_thread_running = 0;
+
+static int64_t *rec_index = NULL;
+static long rec_index_len = 0;
+static long rec_index_alloc = 0;
+
+static FILE *play_file = NULL;
+static int64_t *play_index = NULL;
+static long play_index_len = 0;
+static long long play_end = 0;        // file offset where the records end
+
+static long long p2cap_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void ring_put(const void *data, int len) {
+  //
+  // copy data into the ring buffer, wrapping around if necessary.
+  // Must be called with rec_mutex held and with enough space available.
+  //
+  int iptr = rec_inptr;
+  int first = P2CAP_RINGLEN - iptr;
+
+  if (first >= len) {
+    memcpy(rec_ring + iptr, data, len);
+    iptr += len;
+  } else {
+    memcpy(rec_ring + iptr, data, first);
+    memcpy(rec_ring, (const unsigned char *)data + first, len - first);
+    iptr = len - first;
+  }
+
+  if (iptr >= P2CAP_RINGLEN) { iptr = 0; }
+
+  g_atomic_int_set(&rec_inptr, iptr);
+}
+
+static gpointer p2cap_writer_thread(gpointer data) {
+  //
+  // Write whatever is in the ring buffer to the file, then sleep a little.
+  //
+  for (;;) {
+    int running = g_atomic_int_get(&rec_thread_running);
+    int iptr = g_atomic_int_get(&rec_inptr);
+    int optr = rec_outptr;
+
+    if (iptr == optr) {
+      if (!running) { break; }
+
+      usleep(50000);
+      continue;
+    }
+
+    if (iptr > optr) {
+      fwrite(rec_ring + optr, 1, iptr - optr, rec_file);
+      optr = iptr;
+    } else {
+      fwrite(rec_ring + optr, 1, P2CAP_RINGLEN - optr, rec_file);
+      optr = 0;
+    }
+
+    g_atomic_int_set(&rec_outptr, optr);
+  }
+
+  return NULL;
+}
+
+void p2cap_start_recording(const char *filename) {
+  unsigned char header[P2CAP_HDRLEN];
+
+  if (p2cap_recording) { return; }
+
+  rec_file = fopen(filename, "wb");
+
+  if (rec_file == NULL) {
+    t_print("%s: cannot open %s\n", __func__, filename);
+    return;
+  }
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, "P2CAP", 6);
+  put_u16(header + 6, P2CAP_VERSION);
+  fwrite(header, 1, sizeof(header), rec_file);
+
+  if (rec_ring == NULL) {
+    rec_ring = g_new(unsigned char, P2CAP_RINGLEN);
+  }
+
+  rec_inptr = rec_outptr = 0;
+  rec_produced = 0;
+  rec_dropped = 0;
+  rec_count = 0;
+  rec_index_len = 0;
+  rec_start = p2cap_now();
+  rec_thread_running = 1;
+  rec_thread_id = g_thread_new("P2 CAPTURE", p2cap_writer_thread, NULL);
+  p2cap_recording = 1;
+  t_print("%s: recording P2 session to %s\n", __func__, filename);
+}
+
+void p2cap_stop_recording(void) {
+  unsigned char trailer[16];
+
+  if (!p2cap_recording) { return; }
+
+  g_mutex_lock(&rec_mutex);
+  p2cap_recording = 0;
+  g_mutex_unlock(&rec_mutex);
+  g_atomic_int_set(&rec_thread_running, 0);
+  g_thread_join(rec_thread_id);
+  rec_thread_id = NULL;
+
+  //
+  // Append the index and the trailer
+  //
+  if (rec_index_len > 0) {
+    fwrite(rec_index, sizeof(int64_t), rec_index_len, rec_file);
+  }
+
+  memset(trailer, 0, sizeof(trailer));
+  memcpy(trailer, "P2IDX", 6);
+  put_u64(trailer + 8, rec_index_len);
+  fwrite(trailer, 1, sizeof(trailer), rec_file);
+  fclose(rec_file);
+  rec_file = NULL;
+  t_print("%s: %ld packets recorded, %ld dropped\n", __func__, rec_count, rec_dropped);
+}
+
+void p2cap_record(int dir, int port, const unsigned char *buffer, int len) {
+  unsigned char header[P2CAP_RECHDRLEN];
+  long long ts = p2cap_now() - rec_start;
+
+  if (len > P2CAP_MAX_PACKET) { len = P2CAP_MAX_PACKET; }
+
+  put_i64(header, ts);
+  put_u16(header + 8, port);
+  header[10] = dir;
+  header[11] = 0;
+  put_u16(header + 12, len);
+  g_mutex_lock(&rec_mutex);
+
+  if (!p2cap_recording) {
+    g_mutex_unlock(&rec_mutex);
+    return;
+  }
+
+  int used = rec_inptr - g_atomic_int_get(&rec_outptr);
+
+  if (used < 0) { used += P2CAP_RINGLEN; }
+
+  if (P2CAP_RINGLEN - used <= P2CAP_RECHDRLEN + len) {
+    rec_dropped++;
+    g_mutex_unlock(&rec_mutex);
+    return;
+  }
+
+  //
+  // Add an index entry for the first packet of each second
+  //
+  if (ts >= 1000000000LL * rec_index_len) {
+    if (rec_index_len >= rec_index_alloc) {
+      rec_index_alloc += 3600;
+      rec_index = g_renew(int64_t, rec_index, rec_index_alloc);
+    }
+
+    rec_index[rec_index_len++] = P2CAP_HDRLEN + rec_produced;
+  }
+
+  ring_put(header, P2CAP_RECHDRLEN);
+  ring_put(buffer, len);
+  rec_produced += P2CAP_RECHDRLEN + len;
+  rec_count++;
+  g_mutex_unlock(&rec_mutex);
+}
+
+int p2cap_open_replay(const char *filename) {
+  unsigned char header[P2CAP_HDRLEN];
+  unsigned char trailer[16];
+  play_file = fopen(filename, "rb");
+
+  if (play_file == NULL) {
+    t_print("%s: cannot open %s\n", __func__, filename);
+    return -1;
+  }
+
+  if (fread(header, 1, sizeof(header), play_file) != sizeof(header) || memcmp(header, "P2CAP", 6) != 0) {
+    t_print("%s: %s is not a P2 capture file\n", __func__, filename);
+    fclose(play_file);
+    play_file = NULL;
+    return -1;
+  }
+
+  if (get_u16(header + 6) != P2CAP_VERSION) {
+    t_print("%s: %s has unsupported version %d\n", __func__, filename, get_u16(header + 6));
+    fclose(play_file);
+    play_file = NULL;
+    return -1;
+  }
+
+  //
+  // Look for the index at the end of the file
+  //
+  play_index_len = 0;
+  fseek(play_file, 0, SEEK_END);
+  play_end = ftell(play_file);
+
+  if (play_end >= P2CAP_HDRLEN + 16) {
+    fseek(play_file, play_end - 16, SEEK_SET);
+
+    if (fread(trailer, 1, sizeof(trailer), play_file) == sizeof(trailer) && memcmp(trailer, "P2IDX", 6) == 0) {
+      long n = get_u64(trailer + 8);
+      play_end -= 16 + n * (long long)sizeof(int64_t);
+
+      if (n > 0 && play_end >= P2CAP_HDRLEN) {
+        play_index = g_new(int64_t, n);
+        fseek(play_file, play_end, SEEK_SET);
+
+        if (fread(play_index, sizeof(int64_t), n, play_file) == (size_t) n) {
+          play_index_len = n;
+        }
+      }
+    }
+  }
+
+  fseek(play_file, P2CAP_HDRLEN, SEEK_SET);
+  t_print("%s: replaying %s (%ld seconds indexed)\n", __func__, filename, play_index_len);
+  return 0;
+}
+
+int p2cap_seek(double seconds) {
+  long i = (long) seconds;
+
+  if (play_file == NULL || i < 0 || i >= play_index_len) { return -1; }
+
+  fseek(play_file, play_index[i], SEEK_SET);
+  return 0;
+}
+
+int p2cap_next(P2CAP_RECORD *rec) {
+  //
+  // Returns 1 if a record has been read, 0 at the end of the file
+  //
+  unsigned char header[P2CAP_RECHDRLEN];
+
+  if (play_file == NULL) { return 0; }
+
+  if (play_end > 0 && ftell(play_file) >= play_end) { return 0; }
+
+  if (fread(header, 1, sizeof(header), play_file) != sizeof(header)) { return 0; }
+
+  rec->ts = get_i64(header);
+  rec->port = get_u16(header + 8);
+  rec->dir = header[10];
+  rec->len = get_u16(header + 12);
+
+  if (rec->len > P2CAP_MAX_PACKET) { return 0; }
+
+  if (fread(rec->data, 1, rec->len, play_file) != (size_t) rec->len) { return 0; }
+
+  return 1;
+}
+
+void p2cap_close_replay(void) {
+  if (play_file) {
+    fclose(play_file);
+    play_file = NULL;
+  }
+
+  g_free(play_index);
+  play_index = NULL;
+  play_index_len = 0;
+}
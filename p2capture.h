@@ -0,0 +1,62 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _P2CAPTURE_H_
+#define _P2CAPTURE_H_
+
+//
+// Recording and replay of protocol 2 sessions.
+//
+// Recording is enabled by setting the environment variable
+// DESKHPSDR_P2_CAPTURE to a file name, replay by setting
+// DESKHPSDR_P2_REPLAY to the name of a recorded file. Replay
+// is done in real time, unless DESKHPSDR_P2_REPLAY_FAST is set.
+//
+
+#define P2CAP_FROM_RADIO 0
+#define P2CAP_TO_RADIO   1
+
+#define P2CAP_MAX_PACKET 1444
+
+typedef struct _p2cap_record {
+  long long     ts;             // nano-seconds since start of recording
+  int           dir;            // P2CAP_FROM_RADIO or P2CAP_TO_RADIO
+  int           port;           // source port (from radio) or destination port (to radio)
+  int           len;
+  unsigned char data[P2CAP_MAX_PACKET];
+} P2CAP_RECORD;
+
+extern volatile int p2cap_recording;
+
+extern void p2cap_start_recording(const char *filename);
+extern void p2cap_stop_recording(void);
+extern void p2cap_record(int dir, int port, const unsigned char *buffer, int len);
+
+extern int  p2cap_open_replay(const char *filename);
+extern int  p2cap_seek(double seconds);
+extern int  p2cap_next(P2CAP_RECORD *rec);
+extern void p2cap_close_replay(void);
+
+//
+// Use this at the call sites in hot paths, such that the overhead
+// is a single test if not recording.
+//
+#define P2CAP_RECORD(dir, port, buffer, len) \
+  do { if (p2cap_recording) { p2cap_record(dir, port, buffer, len); } } while (0)
+
+#endif
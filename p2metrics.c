@@ -0,0 +1,100 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#include <gtk/gtk.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "p2metrics.h"
+#include "message.h"
+
+//
+// p2m always points to valid memory: if the shared memory segment
+// cannot be created, a private copy is used such that the counters
+// in the hot paths need not be checked against NULL.
+//
+P2M_SHM *p2m = NULL;
+static int p2m_shared = 0;
+
+void p2metrics_exit(void) {
+  //
+  // Remove the name of the segment, so that no stale segments are left
+  // behind. A p2stat that has it mapped keeps its mapping.
+  //
+  if (p2m_shared) {
+    shm_unlink(P2M_SHM_NAME);
+    p2m_shared = 0;
+  }
+}
+
+void p2metrics_init(void) {
+  int fd;
+  void *mem = MAP_FAILED;
+
+  if (p2m != NULL) { return; }
+
+  fd = shm_open(P2M_SHM_NAME, O_CREAT | O_RDWR, 0644);
+
+  if (fd >= 0) {
+    if (ftruncate(fd, sizeof(P2M_SHM)) == 0) {
+      mem = mmap(NULL, sizeof(P2M_SHM), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+
+    close(fd);
+  }
+
+  if (mem == MAP_FAILED) {
+    t_print("%s: cannot create shared memory %s, metrics are not exported\n", __func__, P2M_SHM_NAME);
+    p2m = g_new(P2M_SHM, 1);
+  } else {
+    t_print("%s: metrics exported in shared memory %s\n", __func__, P2M_SHM_NAME);
+    p2m = (P2M_SHM *) mem;
+    p2m_shared = 1;
+    atexit(p2metrics_exit);
+  }
+
+  memset(p2m, 0, sizeof(P2M_SHM));
+  snprintf(p2m->thread[P2M_MAIN].name, 16, "P2 main");
+
+  for (int i = 0; i < P2M_MAX_DDC; i++) {
+    snprintf(p2m->thread[P2M_DDC0 + i].name, 16, "P2 DDC%d", i);
+  }
+
+  snprintf(p2m->thread[P2M_MIC].name, 16, "P2 MIC");
+  snprintf(p2m->thread[P2M_HP].name, 16, "P2 HP");
+  snprintf(p2m->thread[P2M_TXIQ].name, 16, "P2 TXIQ");
+  snprintf(p2m->thread[P2M_RXAUDIO].name, 16, "P2 SPKR");
+  snprintf(p2m->thread[P2M_TIMER].name, 16, "P2 task");
+  p2m->version = P2M_VERSION;
+  p2m->size = sizeof(P2M_SHM);
+  p2m->nthreads = P2M_NUM_THREADS;
+  p2m->pid = getpid();
+  p2m->start_time = time(NULL);
+  //
+  // Write the magic number last, so the reader knows the
+  // header is complete
+  //
+  __atomic_store_n(&p2m->magic, P2M_MAGIC, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,113 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _P2METRICS_H_
+#define _P2METRICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+//
+// Run-time metrics of the protocol 2 threads, published in a
+// shared memory segment which can be inspected with "p2stat".
+// The segment is unlinked at exit (p2metrics_exit, registered with
+// atexit() by p2metrics_init).
+//
+// This file is also included by p2stat.c, so it must not depend
+// on any other deskHPSDR header.
+//
+// Each thread (or stream) has its own set of counters, in a cache line
+// of its own. The counters of a DDC may be updated by several IQ workers,
+// so all updates are atomic (relaxed), and the reader may see a slightly
+// inconsistent snapshot (which does not matter).
+//
+// Increment P2M_VERSION whenever the layout of P2M_SHM changes.
+//
+
+#define P2M_SHM_NAME  "/deskhpsdr_p2metrics"
+#define P2M_MAGIC     0x50324D54   // "P2MT"
+#define P2M_VERSION   2
+#define P2M_MAX_DDC   8
+
+enum _p2m_thread_id {
+  P2M_MAIN = 0,                    // new_protocol_thread (network receive)
+  P2M_DDC0,                        // iq_thread, one per DDC
+  P2M_MIC = P2M_DDC0 + P2M_MAX_DDC,
+  P2M_HP,                          // high_priority_thread
+  P2M_TXIQ,                        // new_protocol_txiq_thread
+  P2M_RXAUDIO,                     // new_protocol_rxaudio_thread
+  P2M_TIMER,                       // new_protocol_timer_thread
+  P2M_NUM_THREADS
+};
+
+//
+// packets:    packets processed (received or sent)
+// wakeups:    number of times the thread has been woken up
+// busy_ns:    time spent processing (not waiting or pacing)
+// ring_hwm:   high-water mark of the input ring buffer (in packets)
+// overflows:  packets dropped (DDC, Mic) or overflow events (TX IQ, RX audio)
+// seq_errors: sequence errors seen in this stream
+//
+typedef struct _p2m_thread {
+  char     name[16];
+  uint64_t packets;
+  uint64_t wakeups;
+  uint64_t busy_ns;
+  uint64_t ring_hwm;
+  uint64_t overflows;
+  uint64_t seq_errors;
+} P2M_THREAD;                      // 64 bytes = one cache line
+
+typedef struct _p2m_shm {
+  uint32_t   magic;
+  uint32_t   version;
+  uint32_t   size;                 // sizeof(P2M_SHM)
+  uint32_t   nthreads;
+  int64_t    pid;
+  int64_t    start_time;           // time(NULL) when created
+  uint64_t   reserved[4];
+  P2M_THREAD thread[P2M_NUM_THREADS];
+} P2M_SHM;
+
+_Static_assert(sizeof(P2M_THREAD) == 64, "P2M_THREAD must fill one cache line");
+_Static_assert(offsetof(P2M_SHM, thread) % 64 == 0, "P2M_SHM.thread must start on a cache line");
+
+extern P2M_SHM *p2m;
+
+extern void p2metrics_init(void);
+extern void p2metrics_exit(void);
+
+static inline uint64_t p2m_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define P2M_ADD(t, field, n) \
+  __atomic_fetch_add(&p2m->thread[t].field, (uint64_t)(n), __ATOMIC_RELAXED)
+
+#define P2M_MAX(t, field, v) \
+  do { \
+    uint64_t _v = (uint64_t)(v); \
+    uint64_t _old = __atomic_load_n(&p2m->thread[t].field, __ATOMIC_RELAXED); \
+    while (_v > _old && !__atomic_compare_exchange_n(&p2m->thread[t].field, &_old, _v, 1, \
+                                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) { } \
+  } while (0)
+
+#endif
@@ -0,0 +1,765 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// p2sim: a stand-alone OpenHPSDR protocol 2 radio simulator
+//
+// This is a separate program (not linked into deskHPSDR) that behaves
+// like an ANAN radio as far as the network is concerned:
+//
+// - it answers discovery packets
+// - it accepts General, HighPrio, RX-specific and TX-specific packets
+// - it streams DDC IQ packets for all enabled DDCs with correct sequence
+//   numbers and time stamps, at the sample rate requested in the
+//   RX-specific packet
+// - it streams Mic samples and HighPrio status packets
+// - it consumes TX IQ and speaker audio samples and models the FPGA
+//   FIFOs, such that under- and overflows are counted and reported
+//   in the HighPrio status packet (and on stdout)
+//
+// Optionally, packet loss, re-ordering and timing jitter can be injected
+// into the stream of packets going to the host. This allows to stress-test
+// the ingest and pacing paths of new_protocol.c without any hardware.
+//
+// Usage: p2sim [-i ipaddr] [-n nddc] [-d device] [-l loss%] [-r reorder%]
+//              [-j jitter_usec] [-v]
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+//
+// Port numbers as defined in the protocol 2 specification.
+// These are the same as in new_protocol.h, but p2sim must
+// be compilable without any deskHPSDR header.
+//
+#define P2SIM_GENERAL_PORT      1024  // from host: discovery and general packet
+#define P2SIM_RXSPEC_PORT       1025  // from host: RX specific
+#define P2SIM_TXSPEC_PORT       1026  // from host: TX specific
+#define P2SIM_HIPRIO_PORT       1027  // from host: HighPrio
+#define P2SIM_AUDIO_PORT        1028  // from host: speaker audio
+#define P2SIM_TXIQ_PORT         1029  // from host: TX IQ samples
+#define P2SIM_HIPRIO_TO_HOST    1025  // to host:   HighPrio status
+#define P2SIM_MIC_TO_HOST       1026  // to host:   Mic samples
+#define P2SIM_DDC0_TO_HOST      1035  // to host:   DDC IQ samples
+
+#define P2SIM_MAX_DDC    8
+#define P2SIM_NUM_SOCK   (6 + P2SIM_MAX_DDC)
+
+#define IQ_SAMPLES_PER_PACKET  238
+#define MIC_SAMPLES_PER_PACKET  64
+
+//
+// Size of the FIFOs in the FPGA (in samples), and the filling level
+// at which the FPGA starts draining them.
+//
+#define DUC_FIFO_SIZE    4096
+#define DUC_FIFO_START   1200
+#define AUDIO_FIFO_SIZE  2048
+#define AUDIO_FIFO_START  512
+
+static int sock[P2SIM_NUM_SOCK];
+static int sock_port[P2SIM_NUM_SOCK];
+
+static struct sockaddr_in host_addr;
+static volatile int have_host = 0;
+static pthread_mutex_t send_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+//
+// Radio state as set by the host
+//
+static volatile int running = 0;
+static volatile int ptt = 0;
+static volatile int ddc_enable = 0;
+static volatile int ddc_rate[P2SIM_MAX_DDC];        // in kHz
+static volatile int ddc_sync = 0;                   // DDC1 synchronized to DDC0
+static volatile unsigned long ddc_phase[P2SIM_MAX_DDC];
+static volatile int drive_level = 0;
+
+//
+// Command line options
+//
+static int num_ddc = 4;
+static int device_type = 5;                         // NEW_DEVICE_ORION2
+static double loss_rate = 0.0;                      // fraction of packets dropped
+static double reorder_rate = 0.0;                   // fraction of packets swapped with the next one
+static int jitter_usec = 0;                         // max. extra delay in the streaming loop
+static int verbose = 0;
+
+//
+// Statistics
+//
+static unsigned long stat_ddc_sent = 0;
+static unsigned long stat_dropped = 0;
+static unsigned long stat_reordered = 0;
+static unsigned long stat_seqerr_hp = 0;
+static unsigned long stat_seqerr_txiq = 0;
+static unsigned long stat_seqerr_audio = 0;
+static unsigned long stat_duc_underrun = 0;
+static unsigned long stat_duc_overflow = 0;
+static unsigned long stat_audio_underrun = 0;
+static unsigned long stat_audio_overflow = 0;
+static volatile int report_underrun = 0;
+static volatile int report_overflow = 0;
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1.0E-9 * ts.tv_nsec;
+}
+
+//
+// A simple and fast random number generator (xorshift),
+// good enough for noise and for the injection of errors.
+//
+static uint32_t rnd_state = 0x12345678;
+
+static inline uint32_t rnd(void) {
+  uint32_t x = rnd_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  rnd_state = x;
+  return x;
+}
+
+static inline double rnd_uniform(void) {
+  return (double) rnd() * 2.3283064365386963E-10;   // 1/(2^32)
+}
+
+static int open_socket(int port, const char *ipaddr) {
+  struct sockaddr_in addr;
+  int optval = 1;
+  int s = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+  if (s < 0) {
+    perror("p2sim: socket");
+    exit(1);
+  }
+
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+  setsockopt(s, SOL_SOCKET, SO_BROADCAST, &optval, sizeof(optval));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = ipaddr ? inet_addr(ipaddr) : htonl(INADDR_ANY);
+
+  if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "p2sim: cannot bind port %d: %s\n", port, strerror(errno));
+    exit(1);
+  }
+
+  return s;
+}
+
+static inline unsigned long get_sequence(const unsigned char *buffer) {
+  return ((unsigned long)buffer[0] << 24) | ((unsigned long)buffer[1] << 16)
+         | ((unsigned long)buffer[2] << 8) | (unsigned long)buffer[3];
+}
+
+static inline void put_sequence(unsigned char *buffer, unsigned long seq) {
+  buffer[0] = (seq >> 24) & 0xFF;
+  buffer[1] = (seq >> 16) & 0xFF;
+  buffer[2] = (seq >>  8) & 0xFF;
+  buffer[3] = (seq      ) & 0xFF;
+}
+
+//
+// Send a packet to the host from a given source port.
+// This is where loss and re-ordering are injected. For re-ordering,
+// the packet is held back and sent after the next packet from the
+// same port.
+//
+static unsigned char held_buffer[P2SIM_NUM_SOCK][1444];
+static int held_length[P2SIM_NUM_SOCK];
+
+static void send_to_host(int idx, const unsigned char *buffer, int len) {
+  if (!have_host) { return; }
+
+  if (loss_rate > 0.0 && rnd_uniform() < loss_rate) {
+    stat_dropped++;
+    return;
+  }
+
+  pthread_mutex_lock(&send_mutex);
+
+  if (reorder_rate > 0.0 && held_length[idx] == 0 && rnd_uniform() < reorder_rate) {
+    memcpy(held_buffer[idx], buffer, len);
+    held_length[idx] = len;
+    stat_reordered++;
+    pthread_mutex_unlock(&send_mutex);
+    return;
+  }
+
+  sendto(sock[idx], buffer, len, 0, (struct sockaddr *)&host_addr, sizeof(host_addr));
+
+  if (held_length[idx] > 0) {
+    sendto(sock[idx], held_buffer[idx], held_length[idx], 0, (struct sockaddr *)&host_addr, sizeof(host_addr));
+    held_length[idx] = 0;
+  }
+
+  pthread_mutex_unlock(&send_mutex);
+}
+
+static void send_discovery_reply(int s, const struct sockaddr_in *to) {
+  unsigned char buffer[60];
+  memset(buffer, 0, sizeof(buffer));
+  buffer[4] = running ? 0x03 : 0x02;      // status: 2 = idle, 3 = sending
+  buffer[5] = 0x00;                       // MAC address
+  buffer[6] = 0x1C;
+  buffer[7] = 0xC0;
+  buffer[8] = 0xA2;
+  buffer[9] = 0x22;
+  buffer[10] = 0x5D;
+  buffer[11] = device_type;               // board type
+  buffer[12] = 39;                        // protocol version
+  buffer[13] = 21;                        // firmware version
+  buffer[20] = num_ddc;                   // number of DDCs
+  buffer[21] = 1;                         // phase word
+  buffer[22] = 0;                         // little endian: no
+  sendto(s, buffer, sizeof(buffer), 0, (const struct sockaddr *)to, sizeof(*to));
+  printf("p2sim: discovery reply sent to %s:%d\n", inet_ntoa(to->sin_addr), ntohs(to->sin_port));
+}
+
+static void process_general(const unsigned char *buffer, const struct sockaddr_in *from) {
+  //
+  // The address from which the host sends the general packet is
+  // the address to which all data going to the host is sent.
+  //
+  memcpy(&host_addr, from, sizeof(host_addr));
+  have_host = 1;
+
+  if (verbose) {
+    printf("p2sim: general packet from %s:%d\n", inet_ntoa(from->sin_addr), ntohs(from->sin_port));
+  }
+}
+
+static void process_rx_specific(const unsigned char *buffer) {
+  int enable = buffer[7];
+
+  for (int i = 0; i < num_ddc; i++) {
+    int rate = (buffer[18 + 6 * i] << 8) | buffer[19 + 6 * i];
+
+    if (rate == 0) { rate = 48; }
+
+    if (rate != ddc_rate[i] && verbose) {
+      printf("p2sim: DDC%d sample rate %d kHz\n", i, rate);
+    }
+
+    ddc_rate[i] = rate;
+  }
+
+  ddc_sync = (buffer[1363] & 0x02) ? 1 : 0;
+
+  if (enable != ddc_enable) {
+    printf("p2sim: DDC enable mask %02X (sync=%d)\n", enable, ddc_sync);
+  }
+
+  ddc_enable = enable & ((1 << num_ddc) - 1);
+}
+
+static void process_high_priority(const unsigned char *buffer) {
+  static unsigned long expected = 0;
+  unsigned long seq = get_sequence(buffer);
+
+  if (seq != expected && seq != 0) {
+    stat_seqerr_hp++;
+  }
+
+  expected = seq + 1;
+
+  for (int i = 0; i < num_ddc; i++) {
+    ddc_phase[i] = get_sequence(buffer + 9 + 4 * i);
+  }
+
+  drive_level = buffer[345];
+
+  if ((buffer[4] & 0x01) != running) {
+    running = buffer[4] & 0x01;
+    printf("p2sim: radio %s\n", running ? "started" : "stopped");
+  }
+
+  ptt = (buffer[4] & 0x02) ? 1 : 0;
+}
+
+//
+// The FIFO model: the FPGA starts draining a FIFO once it has been
+// filled up to the "start" level, and continues to drain it at the
+// nominal rate. If it runs empty, this is an underrun and draining stops
+// until the "start" level is reached again. If a packet does not fit,
+// this is an overflow.
+//
+typedef struct _fifo_model {
+  double level;
+  double last;
+  int draining;
+  double rate;
+  double size;
+  double start;
+} FIFO_MODEL;
+
+static FIFO_MODEL duc_fifo   = { 0.0, 0.0, 0, 192000.0, DUC_FIFO_SIZE, DUC_FIFO_START };
+static FIFO_MODEL audio_fifo = { 0.0, 0.0, 0,  48000.0, AUDIO_FIFO_SIZE, AUDIO_FIFO_START };
+
+static void fifo_add(FIFO_MODEL *fifo, int samples, unsigned long *underrun, unsigned long *overflow) {
+  double now = now_sec();
+
+  if (fifo->draining) {
+    fifo->level -= (now - fifo->last) * fifo->rate;
+
+    if (fifo->level < 0.0) {
+      fifo->level = 0.0;
+      fifo->draining = 0;
+      (*underrun)++;
+      report_underrun = 1;
+    }
+  }
+
+  fifo->last = now;
+
+  if (fifo->level + samples > fifo->size) {
+    (*overflow)++;
+    report_overflow = 1;
+    return;
+  }
+
+  fifo->level += samples;
+
+  if (fifo->level >= fifo->start) { fifo->draining = 1; }
+}
+
+static void process_txiq(const unsigned char *buffer) {
+  static unsigned long expected = 0;
+  unsigned long seq = get_sequence(buffer);
+
+  if (seq != expected && seq != 0) {
+    stat_seqerr_txiq++;
+  }
+
+  expected = seq + 1;
+
+  //
+  // TX IQ samples only enter the DUC FIFO while transmitting
+  //
+  if (ptt) {
+    fifo_add(&duc_fifo, 240, &stat_duc_underrun, &stat_duc_overflow);
+  } else {
+    duc_fifo.level = 0.0;
+    duc_fifo.draining = 0;
+  }
+}
+
+static void process_audio(const unsigned char *buffer) {
+  static unsigned long expected = 0;
+  unsigned long seq = get_sequence(buffer);
+
+  if (seq != expected && seq != 0) {
+    stat_seqerr_audio++;
+  }
+
+  expected = seq + 1;
+  fifo_add(&audio_fifo, 64, &stat_audio_underrun, &stat_audio_overflow);
+}
+
+static void *receive_thread(void *arg) {
+  unsigned char buffer[2048];
+  struct sockaddr_in from;
+  socklen_t fromlen;
+
+  for (;;) {
+    fd_set fds;
+    int maxfd = 0;
+    FD_ZERO(&fds);
+
+    for (int i = 0; i < 6; i++) {
+      FD_SET(sock[i], &fds);
+
+      if (sock[i] > maxfd) { maxfd = sock[i]; }
+    }
+
+    if (select(maxfd + 1, &fds, NULL, NULL, NULL) <= 0) { continue; }
+
+    for (int i = 0; i < 6; i++) {
+      if (!FD_ISSET(sock[i], &fds)) { continue; }
+
+      fromlen = sizeof(from);
+      int len = recvfrom(sock[i], buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &fromlen);
+
+      if (len <= 0) { continue; }
+
+      switch (sock_port[i]) {
+      case P2SIM_GENERAL_PORT:
+        if (len == 60 && get_sequence(buffer) == 0 && buffer[4] == 0x02) {
+          send_discovery_reply(sock[i], &from);
+        } else if (len == 60 && buffer[4] == 0x00) {
+          process_general(buffer, &from);
+        }
+
+        break;
+
+      case P2SIM_RXSPEC_PORT:
+        if (len == 1444) { process_rx_specific(buffer); }
+
+        break;
+
+      case P2SIM_TXSPEC_PORT:
+        // nothing to simulate here
+        break;
+
+      case P2SIM_HIPRIO_PORT:
+        if (len == 1444) { process_high_priority(buffer); }
+
+        break;
+
+      case P2SIM_AUDIO_PORT:
+        if (len == 260) { process_audio(buffer); }
+
+        break;
+
+      case P2SIM_TXIQ_PORT:
+        if (len == 1444) { process_txiq(buffer); }
+
+        break;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+//
+// Signal generator: each DDC sees a weak carrier whose offset depends
+// on the DDC phase word, such that tuning the VFO moves the signal
+// on the panadapter, plus some noise.
+//
+typedef struct _ddc_gen {
+  double re, im;            // phasor
+  unsigned long sequence;
+  unsigned long long timestamp;
+  double next;              // time when the next packet is due
+  int idx;                  // socket index
+} DDC_GEN;
+
+static DDC_GEN ddc_gen[P2SIM_MAX_DDC];
+
+static inline void put_sample(unsigned char *p, double x) {
+  int v = (int)(x * 8388607.0);
+  p[0] = (v >> 16) & 0xFF;
+  p[1] = (v >>  8) & 0xFF;
+  p[2] = (v      ) & 0xFF;
+}
+
+static void fill_iq(DDC_GEN *gen, int ddc, unsigned char *p, int n, int stride) {
+  //
+  // Carrier at 14.075 MHz (a "virtual FT8 signal"), i.e. at
+  // (14075000 - DDC frequency) Hz, if within the pass band.
+  // The constant 34.952533 is 2^32 / 122.88 MHz.
+  //
+  double fddc = (double) ddc_phase[ddc] / 34.952533333333333;
+  double rate = 1000.0 * ddc_rate[ddc];
+  double df = 14075000.0 - fddc;
+  double amp = fabs(df) < 0.45 * rate ? 1.0E-3 : 0.0;
+  double w = 2.0 * M_PI * df / rate;
+  double c = cos(w), s = sin(w);
+
+  for (int i = 0; i < n; i++) {
+    double re = gen->re * c - gen->im * s;
+    double im = gen->re * s + gen->im * c;
+    gen->re = re;
+    gen->im = im;
+    put_sample(p,     amp * re + 1.0E-5 * (rnd_uniform() - 0.5));
+    put_sample(p + 3, amp * im + 1.0E-5 * (rnd_uniform() - 0.5));
+    p += stride;
+  }
+
+  //
+  // re-normalize the phasor to avoid drift of the amplitude
+  //
+  double norm = 1.0 / sqrt(gen->re * gen->re + gen->im * gen->im);
+  gen->re *= norm;
+  gen->im *= norm;
+}
+
+static void send_ddc_packet(int ddc) {
+  unsigned char buffer[1444];
+  DDC_GEN *gen = &ddc_gen[ddc];
+  put_sequence(buffer, gen->sequence++);
+
+  for (int i = 0; i < 8; i++) {
+    buffer[4 + i] = (gen->timestamp >> (56 - 8 * i)) & 0xFF;
+  }
+
+  buffer[12] = 0;
+  buffer[13] = 24;                            // bits per sample
+  buffer[14] = (IQ_SAMPLES_PER_PACKET >> 8) & 0xFF;
+  buffer[15] = IQ_SAMPLES_PER_PACKET & 0xFF;
+
+  if (ddc == 0 && ddc_sync) {
+    //
+    // DDC0 and DDC1 synchronized: the packet contains 119
+    // interleaved sample pairs, DDC0 first.
+    //
+    fill_iq(gen, 0, buffer + 16, IQ_SAMPLES_PER_PACKET / 2, 12);
+    fill_iq(&ddc_gen[1], 1, buffer + 22, IQ_SAMPLES_PER_PACKET / 2, 12);
+    gen->timestamp += IQ_SAMPLES_PER_PACKET / 2;
+  } else {
+    fill_iq(gen, ddc, buffer + 16, IQ_SAMPLES_PER_PACKET, 6);
+    gen->timestamp += IQ_SAMPLES_PER_PACKET;
+  }
+
+  send_to_host(gen->idx, buffer, sizeof(buffer));
+  stat_ddc_sent++;
+}
+
+static void send_mic_packet(int idx) {
+  static unsigned long sequence = 0;
+  unsigned char buffer[132];
+  put_sequence(buffer, sequence++);
+  memset(buffer + 4, 0, sizeof(buffer) - 4);
+  send_to_host(idx, buffer, sizeof(buffer));
+}
+
+static void send_hp_packet(int idx) {
+  static unsigned long sequence = 0;
+  unsigned char buffer[60];
+  memset(buffer, 0, sizeof(buffer));
+  put_sequence(buffer, sequence++);
+  buffer[4] = ptt;
+
+  if (report_underrun) { buffer[4] |= 0x20; }
+
+  if (report_overflow) { buffer[4] |= 0x40; }
+
+  report_underrun = report_overflow = 0;
+
+  if (ptt) {
+    //
+    // Produce some forward power, proportional to the drive
+    // level, and a little bit of reverse power (SWR 1.2)
+    //
+    int fwd = 16 * drive_level;
+    int rev = fwd / 120;
+    buffer[6]  = (fwd >> 9) & 0xFF;
+    buffer[7]  = (fwd >> 1) & 0xFF;
+    buffer[14] = (fwd >> 8) & 0xFF;
+    buffer[15] = (fwd     ) & 0xFF;
+    buffer[22] = (rev >> 8) & 0xFF;
+    buffer[23] = (rev     ) & 0xFF;
+  }
+
+  buffer[59] = 0x07;                          // IO4/IO5/IO6 inactive (high)
+  send_to_host(idx, buffer, sizeof(buffer));
+}
+
+static void *stream_thread(void *arg) {
+  double next_mic = 0.0;
+  double next_hp = 0.0;
+  int mic_idx = -1, hp_idx = -1;
+
+  for (int i = 0; i < P2SIM_NUM_SOCK; i++) {
+    if (sock_port[i] == P2SIM_MIC_TO_HOST) { mic_idx = i; }
+
+    if (sock_port[i] == P2SIM_HIPRIO_TO_HOST) { hp_idx = i; }
+  }
+
+  for (;;) {
+    double now = now_sec();
+
+    if (!running || !have_host) {
+      //
+      // idle: reset sequence numbers, such that the next
+      // start begins with sequence number zero.
+      //
+      for (int i = 0; i < num_ddc; i++) {
+        ddc_gen[i].sequence = 0;
+        ddc_gen[i].next = now;
+      }
+
+      next_mic = next_hp = now;
+      usleep(10000);
+      continue;
+    }
+
+    double earliest = now + 0.01;
+
+    for (int i = 0; i < num_ddc; i++) {
+      if (!(ddc_enable & (1 << i))) {
+        ddc_gen[i].next = now;
+        continue;
+      }
+
+      double period = (double) IQ_SAMPLES_PER_PACKET / (1000.0 * ddc_rate[i]);
+
+      if (i == 0 && ddc_sync) { period *= 0.5; }
+
+      while (ddc_gen[i].next <= now) {
+        send_ddc_packet(i);
+        ddc_gen[i].next += period;
+      }
+
+      if (ddc_gen[i].next < earliest) { earliest = ddc_gen[i].next; }
+    }
+
+    while (next_mic <= now) {
+      send_mic_packet(mic_idx);
+      next_mic += (double) MIC_SAMPLES_PER_PACKET / 48000.0;
+    }
+
+    if (next_mic < earliest) { earliest = next_mic; }
+
+    //
+    // HighPrio status: every 50 msec during RX, every 5 msec during TX
+    //
+    if (next_hp <= now) {
+      send_hp_packet(hp_idx);
+      next_hp = now + (ptt ? 0.005 : 0.050);
+    }
+
+    if (next_hp < earliest) { earliest = next_hp; }
+
+    if (jitter_usec > 0) {
+      earliest += 1.0E-6 * jitter_usec * rnd_uniform();
+    }
+
+    struct timespec ts;
+    ts.tv_sec = (time_t) earliest;
+    ts.tv_nsec = (long)((earliest - ts.tv_sec) * 1.0E9);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+  }
+
+  return NULL;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-i ipaddr] [-n nddc] [-d device] [-l loss%%] [-r reorder%%] [-j jitter_usec] [-v]\n",
+          name);
+  fprintf(stderr, "  -i ipaddr  address to bind to (default: all interfaces)\n");
+  fprintf(stderr, "  -n nddc    number of DDCs (1...%d, default 4)\n", P2SIM_MAX_DDC);
+  fprintf(stderr, "  -d device  board type reported in discovery (default 5 = Orion2)\n");
+  fprintf(stderr, "  -l loss    percentage of packets to host that are dropped\n");
+  fprintf(stderr, "  -r reorder percentage of packets to host that are re-ordered\n");
+  fprintf(stderr, "  -j jitter  max. random delay (usec) of the streaming loop\n");
+  fprintf(stderr, "  -v         verbose\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  const char *ipaddr = NULL;
+  pthread_t rx_id, stream_id;
+  int c;
+
+  while ((c = getopt(argc, argv, "i:n:d:l:r:j:v")) != -1) {
+    switch (c) {
+    case 'i':
+      ipaddr = optarg;
+      break;
+
+    case 'n':
+      num_ddc = atoi(optarg);
+
+      if (num_ddc < 1 || num_ddc > P2SIM_MAX_DDC) { usage(argv[0]); }
+
+      break;
+
+    case 'd':
+      device_type = atoi(optarg);
+      break;
+
+    case 'l':
+      loss_rate = 0.01 * atof(optarg);
+      break;
+
+    case 'r':
+      reorder_rate = 0.01 * atof(optarg);
+      break;
+
+    case 'j':
+      jitter_usec = atoi(optarg);
+      break;
+
+    case 'v':
+      verbose = 1;
+      break;
+
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  //
+  // Sockets 0...5 receive data from the host, sockets 1,2 are also used
+  // to send HighPrio and Mic data to the host, and sockets 6... are
+  // used to send DDC data.
+  //
+  sock_port[0] = P2SIM_GENERAL_PORT;
+  sock_port[1] = P2SIM_RXSPEC_PORT;
+  sock_port[2] = P2SIM_TXSPEC_PORT;
+  sock_port[3] = P2SIM_HIPRIO_PORT;
+  sock_port[4] = P2SIM_AUDIO_PORT;
+  sock_port[5] = P2SIM_TXIQ_PORT;
+
+  for (int i = 0; i < P2SIM_MAX_DDC; i++) {
+    sock_port[6 + i] = P2SIM_DDC0_TO_HOST + i;
+  }
+
+  for (int i = 0; i < P2SIM_NUM_SOCK; i++) {
+    sock[i] = open_socket(sock_port[i], ipaddr);
+  }
+
+  for (int i = 0; i < P2SIM_MAX_DDC; i++) {
+    ddc_rate[i] = 48;
+    ddc_gen[i].re = 1.0;
+    ddc_gen[i].im = 0.0;
+    ddc_gen[i].idx = 6 + i;
+  }
+
+  printf("p2sim: simulating board type %d with %d DDCs (loss=%.1f%% reorder=%.1f%% jitter=%d usec)\n",
+         device_type, num_ddc, 100.0 * loss_rate, 100.0 * reorder_rate, jitter_usec);
+  pthread_create(&rx_id, NULL, receive_thread, NULL);
+  pthread_create(&stream_id, NULL, stream_thread, NULL);
+
+  //
+  // Report statistics every 5 seconds
+  //
+  for (;;) {
+    sleep(5);
+
+    if (!running) { continue; }
+
+    printf("p2sim: DDC pkts=%lu dropped=%lu reordered=%lu | SeqErr HP=%lu TXIQ=%lu AUDIO=%lu"
+           " | DUC under=%lu over=%lu | AUDIO under=%lu over=%lu\n",
+           stat_ddc_sent, stat_dropped, stat_reordered,
+           stat_seqerr_hp, stat_seqerr_txiq, stat_seqerr_audio,
+           stat_duc_underrun, stat_duc_overflow, stat_audio_underrun, stat_audio_overflow);
+  }
+
+  return 0;
+}
@@ -0,0 +1,151 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// p2stat: display the protocol 2 metrics of a running deskHPSDR
+//
+// This is a separate program that maps the shared memory segment
+// created by p2metrics.c (read-only) and periodically prints the
+// counters and their rates.
+//
+// Usage: p2stat [-i interval_sec] [-1]
+//
+// -1 prints the absolute counters once and exits.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "p2metrics.h"
+
+static void print_header(void) {
+  printf("%-10s %12s %10s %10s %7s %8s %10s %8s\n",
+         "thread", "packets", "pkt/s", "wakeup/s", "busy%", "ringhwm", "overflows", "seqerr");
+}
+
+int main(int argc, char **argv) {
+  int c;
+  double interval = 1.0;
+  int once = 0;
+  int fd;
+  const P2M_SHM *shm;
+  P2M_SHM last;
+
+  while ((c = getopt(argc, argv, "i:1")) != -1) {
+    switch (c) {
+    case 'i':
+      interval = atof(optarg);
+
+      if (interval < 0.1) { interval = 0.1; }
+
+      break;
+
+    case '1':
+      once = 1;
+      break;
+
+    default:
+      fprintf(stderr, "Usage: %s [-i interval_sec] [-1]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  fd = shm_open(P2M_SHM_NAME, O_RDONLY, 0);
+
+  if (fd < 0) {
+    fprintf(stderr, "p2stat: cannot open %s: %s (is deskHPSDR running?)\n", P2M_SHM_NAME, strerror(errno));
+    return 1;
+  }
+
+  shm = mmap(NULL, sizeof(P2M_SHM), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (shm == MAP_FAILED) {
+    fprintf(stderr, "p2stat: mmap failed: %s\n", strerror(errno));
+    return 1;
+  }
+
+  if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != P2M_MAGIC || shm->version != P2M_VERSION
+      || shm->size != sizeof(P2M_SHM)) {
+    fprintf(stderr, "p2stat: incompatible metrics segment (version %u, size %u; expected version %u, size %u)\n",
+            shm->version, shm->size, P2M_VERSION, (unsigned) sizeof(P2M_SHM));
+    return 1;
+  }
+
+  if (kill((pid_t) shm->pid, 0) < 0 && errno == ESRCH) {
+    fprintf(stderr, "p2stat: warning: process %ld that created the metrics no longer exists\n", (long) shm->pid);
+  }
+
+  if (once) {
+    printf("%-10s %12s %12s %14s %8s %10s %8s\n", "thread", "packets", "wakeups", "busy_ns", "ringhwm", "overflows",
+           "seqerr");
+
+    for (int i = 0; i < P2M_NUM_THREADS; i++) {
+      const P2M_THREAD *t = &shm->thread[i];
+
+      if (t->packets == 0 && t->wakeups == 0) { continue; }
+
+      printf("%-10s %12llu %12llu %14llu %8llu %10llu %8llu\n", t->name,
+             (unsigned long long) t->packets, (unsigned long long) t->wakeups,
+             (unsigned long long) t->busy_ns, (unsigned long long) t->ring_hwm,
+             (unsigned long long) t->overflows, (unsigned long long) t->seq_errors);
+    }
+
+    return 0;
+  }
+
+  memcpy(&last, shm, sizeof(P2M_SHM));
+
+  for (;;) {
+    usleep((useconds_t)(interval * 1.0E6));
+    printf("\n--- pid %ld, up %ld sec ---\n", (long) shm->pid, (long)(time(NULL) - shm->start_time));
+    print_header();
+
+    for (int i = 0; i < P2M_NUM_THREADS; i++) {
+      const P2M_THREAD *t = &shm->thread[i];
+      P2M_THREAD *l = &last.thread[i];
+      P2M_THREAD now;
+      memcpy(&now, t, sizeof(now));
+
+      if (now.packets == 0 && now.wakeups == 0) { continue; }
+
+      printf("%-10s %12llu %10.1f %10.1f %7.2f %8llu %10llu %8llu\n", now.name,
+             (unsigned long long) now.packets,
+             (now.packets - l->packets) / interval,
+             (now.wakeups - l->wakeups) / interval,
+             100.0 * (now.busy_ns - l->busy_ns) / (interval * 1.0E9),
+             (unsigned long long) now.ring_hwm,
+             (unsigned long long) now.overflows,
+             (unsigned long long) now.seq_errors);
+      memcpy(l, &now, sizeof(now));
+    }
+
+    fflush(stdout);
+  }
+
+  return 0;
+}
@@ -0,0 +1,208 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifdef P2TRACE
+
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE     // for pthread_getname_np()
+#endif
+
+#include <gtk/gtk.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "p2trace.h"
+#include "message.h"
+
+//
+// Each thread that records an event gets its own ring buffer upon
+// the first event. Only the owning thread writes into the ring, so
+// recording an event is a time stamp, four stores and an increment.
+// The rings are linked into a global list (protected by a mutex, but
+// this is only used when a new thread shows up and when dumping).
+//
+// Threads come and go (e.g. upon each protocol restart), so when a
+// thread exits, its ring is marked as unused (by a thread-specific data
+// destructor) and handed over to the next new thread. The events of an
+// exited thread remain in the dump until its ring is re-used.
+//
+#define P2TRACE_RINGLEN 65536       // must be a power of two
+
+typedef struct _p2trace_event {
+  uint64_t    ts;                   // nsec, CLOCK_MONOTONIC
+  const char *name;
+  int         arg;
+  char        phase;                // 'B', 'E' or 'i'
+} P2TRACE_EVENT;
+
+typedef struct _p2trace_ring {
+  struct _p2trace_ring *next;
+  int                   tid;
+  int                   in_use;     // owned by a running thread
+  char                  name[16];
+  volatile uint64_t     head;       // number of events written so far
+  P2TRACE_EVENT         ev[P2TRACE_RINGLEN];
+} P2TRACE_RING;
+
+volatile int p2trace_enabled = 0;
+
+static P2TRACE_RING *rings = NULL;
+static int num_tids = 0;
+static GMutex ring_mutex;
+static __thread P2TRACE_RING *my_ring = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static const char *dump_file = NULL;
+
+static void p2trace_release_ring(void *data) {
+  //
+  // Called when a thread that has recorded events exits
+  //
+  P2TRACE_RING *ring = (P2TRACE_RING *) data;
+  g_mutex_lock(&ring_mutex);
+  ring->in_use = 0;
+  g_mutex_unlock(&ring_mutex);
+}
+
+static void p2trace_make_key(void) {
+  pthread_key_create(&ring_key, p2trace_release_ring);
+}
+
+static P2TRACE_RING *p2trace_new_ring(void) {
+  P2TRACE_RING *ring;
+  char name[16] = "";
+  pthread_once(&ring_key_once, p2trace_make_key);
+#if defined(__linux__) || defined(__APPLE__)
+  pthread_getname_np(pthread_self(), name, sizeof(name));
+#endif
+  g_mutex_lock(&ring_mutex);
+
+  for (ring = rings; ring; ring = ring->next) {
+    if (!ring->in_use) { break; }
+  }
+
+  if (ring == NULL) {
+    ring = g_new0(P2TRACE_RING, 1);
+    ring->next = rings;
+    rings = ring;
+  }
+
+  ring->in_use = 1;
+  ring->tid = ++num_tids;
+  __atomic_store_n(&ring->head, 0, __ATOMIC_RELEASE);
+
+  if (name[0] == 0) {
+    snprintf(name, sizeof(name), "thread %d", ring->tid);
+  }
+
+  memcpy(ring->name, name, sizeof(ring->name));
+  g_mutex_unlock(&ring_mutex);
+  pthread_setspecific(ring_key, ring);
+  return ring;
+}
+
+void p2trace_event(const char *name, char phase, int arg) {
+  struct timespec ts;
+  P2TRACE_RING *ring = my_ring;
+
+  if (ring == NULL) {
+    ring = my_ring = p2trace_new_ring();
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t h = ring->head;
+  P2TRACE_EVENT *ev = &ring->ev[h & (P2TRACE_RINGLEN - 1)];
+  ev->ts = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  ev->name = name;
+  ev->arg = arg;
+  ev->phase = phase;
+  __atomic_store_n(&ring->head, h + 1, __ATOMIC_RELEASE);
+}
+
+void p2trace_init(void) {
+  dump_file = getenv("DESKHPSDR_P2TRACE");
+
+  if (dump_file) {
+    t_print("%s: tracing enabled, dump file: %s\n", __func__, dump_file);
+    p2trace_enabled = 1;
+  }
+}
+
+void p2trace_enable(int on) {
+  p2trace_enabled = on;
+}
+
+int p2trace_dump(const char *filename) {
+  //
+  // Tracing is suspended while dumping, so the rings do not
+  // change under our feet (except for events already "in flight").
+  //
+  int was_enabled = p2trace_enabled;
+  long count = 0;
+  FILE *fp = fopen(filename, "w");
+
+  if (fp == NULL) {
+    t_print("%s: cannot open %s\n", __func__, filename);
+    return -1;
+  }
+
+  p2trace_enabled = 0;
+  g_mutex_lock(&ring_mutex);
+  fprintf(fp, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+  fprintf(fp, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"deskHPSDR\"}}");
+
+  for (const P2TRACE_RING *ring = rings; ring; ring = ring->next) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t first = head > P2TRACE_RINGLEN ? head - P2TRACE_RINGLEN : 0;
+    fprintf(fp, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+            ring->tid, ring->name);
+
+    for (uint64_t i = first; i < head; i++) {
+      const P2TRACE_EVENT *ev = &ring->ev[i & (P2TRACE_RINGLEN - 1)];
+      fprintf(fp, ",\n{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d",
+              ev->name, ev->phase, ev->ts * 1.0E-3, ring->tid);
+
+      if (ev->phase == 'i') {
+        fprintf(fp, ", \"s\": \"t\", \"args\": {\"arg\": %d}", ev->arg);
+      }
+
+      fprintf(fp, "}");
+      count++;
+    }
+  }
+
+  fprintf(fp, "\n]}\n");
+  g_mutex_unlock(&ring_mutex);
+  fclose(fp);
+  p2trace_enabled = was_enabled;
+  t_print("%s: %ld events written to %s\n", __func__, count, filename);
+  return 0;
+}
+
+void p2trace_exit(void) {
+  if (dump_file) {
+    p2trace_dump(dump_file);
+  }
+}
+
+#endif
@@ -0,0 +1,65 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _P2TRACE_H_
+#define _P2TRACE_H_
+
+//
+// Event tracer, compiled in with -DP2TRACE.
+//
+// Events are written into per-thread ring buffers (the newest events
+// overwrite the oldest ones) and can be dumped in the Chrome trace
+// JSON format, which can be loaded into chrome://tracing or Perfetto.
+//
+// Tracing is switched on at run-time with p2trace_enable(1), or by
+// setting the environment variable DESKHPSDR_P2TRACE to the name of
+// the file into which the trace is dumped when the program ends.
+//
+// Event names must be string literals (only the pointer is stored).
+//
+
+#ifdef P2TRACE
+
+extern volatile int p2trace_enabled;
+
+extern void p2trace_init(void);
+extern void p2trace_enable(int on);
+extern void p2trace_event(const char *name, char phase, int arg);
+extern int  p2trace_dump(const char *filename);
+extern void p2trace_exit(void);
+
+#define P2TRACE_BEGIN(name)        do { if (p2trace_enabled) { p2trace_event(name, 'B', 0); } } while (0)
+#define P2TRACE_END(name)          do { if (p2trace_enabled) { p2trace_event(name, 'E', 0); } } while (0)
+#define P2TRACE_INSTANT(name, arg) do { if (p2trace_enabled) { p2trace_event(name, 'i', arg); } } while (0)
+
+#else
+
+#define P2TRACE_BEGIN(name)        do { } while (0)
+#define P2TRACE_END(name)          do { } while (0)
+#define P2TRACE_INSTANT(name, arg) do { } while (0)
+
+#endif
+
+//
+// Use instead of g_idle_add() where the hand-over to the main
+// thread should show up in the trace.
+//
+#define P2TRACE_IDLE_ADD(func, data) \
+  do { P2TRACE_INSTANT("g_idle_add " #func, 0); g_idle_add(func, data); } while (0)
+
+#endif
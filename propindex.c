@@ -0,0 +1,179 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Hash-indexed property store
+//
+// Restoring the state looks up several thousand keys such as
+// "band.%d.stack.%d.ctcss" or "modeset.%d.rxeqfrq.%d". With a list
+// that is searched from the beginning, each lookup costs a number of
+// strcmp() calls that grows with the size of the props file.
+//
+// Here, the entries are kept in an array (in insertion order), and
+// the index is an open-addressing hash table with linear probing that
+// holds entry numbers. Each slot also holds the full 32-bit hash, so
+// strcmp() is only called if the hashes match, i.e. practically once
+// per successful lookup. The table is kept at most half full and
+// doubled when needed.
+//
+// Names and values are interned in a GStringChunk: one allocation per
+// few kB instead of two per property, and the whole store is freed
+// at once when the props are cleared.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <gtk/gtk.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "propindex.h"
+
+typedef struct _prop_entry {
+  const char *name;
+  const char *value;
+  uint32_t    hash;
+} PROP_ENTRY;
+
+struct _prop_index {
+  PROP_ENTRY   *entry;
+  int           count;
+  int           alloc;
+  int32_t      *slot;               // entry number, or -1 if empty
+  uint32_t      mask;               // number of slots - 1
+  GStringChunk *strings;
+};
+
+static uint32_t prop_hash(const char *s) {
+  //
+  // FNV-1a
+  //
+  uint32_t h = 2166136261u;
+
+  while (*s) {
+    h = (h ^ (unsigned char) *s++) * 16777619u;
+  }
+
+  return h;
+}
+
+static void prop_index_rehash(PROP_INDEX *pi, uint32_t nslots) {
+  g_free(pi->slot);
+  pi->slot = g_new(int32_t, nslots);
+  memset(pi->slot, 0xFF, nslots * sizeof(int32_t));
+  pi->mask = nslots - 1;
+
+  for (int i = 0; i < pi->count; i++) {
+    uint32_t k = pi->entry[i].hash & pi->mask;
+
+    while (pi->slot[k] >= 0) { k = (k + 1) & pi->mask; }
+
+    pi->slot[k] = i;
+  }
+}
+
+static int32_t prop_index_find(const PROP_INDEX *pi, const char *name, uint32_t h, uint32_t *pos) {
+  uint32_t k = h & pi->mask;
+
+  for (;;) {
+    int32_t i = pi->slot[k];
+
+    if (i < 0 || (pi->entry[i].hash == h && !strcmp(pi->entry[i].name, name))) {
+      *pos = k;
+      return i;
+    }
+
+    k = (k + 1) & pi->mask;
+  }
+}
+
+PROP_INDEX *prop_index_new(int size_hint) {
+  PROP_INDEX *pi = g_new0(PROP_INDEX, 1);
+  uint32_t nslots = 64;
+
+  while (nslots < 2 * (uint32_t) size_hint) { nslots *= 2; }
+
+  pi->alloc = nslots / 2;
+  pi->entry = g_new(PROP_ENTRY, pi->alloc);
+  pi->strings = g_string_chunk_new(4096);
+  prop_index_rehash(pi, nslots);
+  return pi;
+}
+
+void prop_index_free(PROP_INDEX *pi) {
+  if (pi == NULL) { return; }
+
+  g_string_chunk_free(pi->strings);
+  g_free(pi->entry);
+  g_free(pi->slot);
+  g_free(pi);
+}
+
+void prop_index_set(PROP_INDEX *pi, const char *name, const char *value) {
+  uint32_t h = prop_hash(name);
+  uint32_t k;
+  int32_t i = prop_index_find(pi, name, h, &k);
+
+  if (i >= 0) {
+    //
+    // Existing property: the old value stays in the string chunk
+    // until the store is freed, but values are rarely replaced.
+    //
+    if (strcmp(pi->entry[i].value, value)) {
+      pi->entry[i].value = g_string_chunk_insert(pi->strings, value);
+    }
+
+    return;
+  }
+
+  if (pi->count >= pi->alloc) {
+    pi->alloc *= 2;
+    pi->entry = g_renew(PROP_ENTRY, pi->entry, pi->alloc);
+    prop_index_rehash(pi, 2 * (pi->mask + 1));
+    (void) prop_index_find(pi, name, h, &k);
+  }
+
+  i = pi->count++;
+  pi->entry[i].name = g_string_chunk_insert_const(pi->strings, name);
+  pi->entry[i].value = g_string_chunk_insert(pi->strings, value);
+  pi->entry[i].hash = h;
+  pi->slot[k] = i;
+}
+
+const char *prop_index_get(const PROP_INDEX *pi, const char *name) {
+  uint32_t k;
+  int32_t i;
+
+  if (pi == NULL) { return NULL; }
+
+  i = prop_index_find(pi, name, prop_hash(name), &k);
+  return i >= 0 ? pi->entry[i].value : NULL;
+}
+
+int prop_index_count(const PROP_INDEX *pi) {
+  return pi ? pi->count : 0;
+}
+
+void prop_index_foreach(const PROP_INDEX *pi, PROP_INDEX_FN fn, void *data) {
+  if (pi == NULL) { return; }
+
+  for (int i = 0; i < pi->count; i++) {
+    fn(pi->entry[i].name, pi->entry[i].value, data);
+  }
+}
@@ -0,0 +1,41 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _PROPINDEX_H_
+#define _PROPINDEX_H_
+
+//
+// Hash-indexed property store.
+//
+// Holds name/value pairs in insertion order (this is the order in
+// which they are written back to the props file), with an
+// open-addressing hash index for lookups by name.
+//
+
+typedef struct _prop_index PROP_INDEX;
+
+typedef void (*PROP_INDEX_FN)(const char *name, const char *value, void *data);
+
+extern PROP_INDEX *prop_index_new(int size_hint);
+extern void        prop_index_free(PROP_INDEX *pi);
+extern void        prop_index_set(PROP_INDEX *pi, const char *name, const char *value);
+extern const char *prop_index_get(const PROP_INDEX *pi, const char *name);
+extern int         prop_index_count(const PROP_INDEX *pi);
+extern void        prop_index_foreach(const PROP_INDEX *pi, PROP_INDEX_FN fn, void *data);
+
+#endif
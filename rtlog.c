@@ -0,0 +1,225 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Non-blocking logger for the real-time threads
+//
+// The queue is a bounded multi-producer/single-consumer queue where each
+// slot carries a sequence number (D. Vyukov's algorithm): a producer
+// claims a slot by advancing the tail with compare-and-swap, fills it,
+// and publishes it by setting the sequence number. There are no locks,
+// and if the queue is full the message is dropped and counted.
+//
+// Rate limiting is done *before* formatting, in the calling thread: each
+// call site has a static RTLOG_SITE (see rtlog.h), and only the first
+// message per second is formatted and queued. This way, a flood of
+// sequence errors costs an atomic increment per packet rather than a
+// vsnprintf() and a write to stderr.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <gtk/gtk.h>
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rtlog.h"
+#include "message.h"
+
+#define RTLOG_QUEUELEN   256       // must be a power of two
+#define RTLOG_MSGLEN     160
+#define RTLOG_WINDOW     1000000000ULL
+
+typedef struct _rtlog_slot {
+  uint64_t     seq;
+  RTLOG_SITE  *site;
+  char         text[RTLOG_MSGLEN];
+} RTLOG_SLOT;
+
+static RTLOG_SLOT queue[RTLOG_QUEUELEN];
+static uint64_t q_tail = 0;        // next slot to be claimed by a producer
+static uint64_t q_head = 0;        // next slot to be read by the writer thread
+static long q_dropped = 0;
+static RTLOG_SITE *sites = NULL;
+static int rtlog_running = 0;
+static GThread *rtlog_thread_id = NULL;
+
+static uint64_t rtlog_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void rtlog_register(RTLOG_SITE *site) {
+  int expected = 0;
+
+  if (!__atomic_compare_exchange_n(&site->registered, &expected, 1, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+
+  RTLOG_SITE *head = __atomic_load_n(&sites, __ATOMIC_ACQUIRE);
+
+  do {
+    site->next = head;
+  } while (!__atomic_compare_exchange_n(&sites, &head, site, TRUE, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+static void rtlog_summary(RTLOG_SITE *site) {
+  //
+  // Report suppressed messages of a site (writer thread only).
+  // The suppressed messages may differ from the one that has been
+  // printed (other DDC, other values), and their arguments are not
+  // known, so only the format is shown.
+  //
+  long n = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_ACQ_REL);
+  int len;
+
+  if (n > 0) {
+    len = strlen(site->fmt);
+
+    if (len > 0 && site->fmt[len - 1] == '\n') { len--; }
+
+    t_print("rtlog: %ld more messages suppressed in last 1 s: \"%.*s\"\n", n, len, site->fmt);
+  }
+}
+
+static void rtlog_output(RTLOG_SITE *site, const char *text) {
+  //
+  // Report what has been suppressed since the previous message
+  // of this site. If this is the first message of the site, messages
+  // counted while it was being queued are reported in the next summary.
+  //
+  if (site->printed) { rtlog_summary(site); }
+
+  t_print("%s", text);
+  site->printed = 1;
+}
+
+static gpointer rtlog_thread(gpointer data) {
+  uint64_t last_scan = 0;
+
+  for (;;) {
+    RTLOG_SLOT *slot = &queue[q_head & (RTLOG_QUEUELEN - 1)];
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) == q_head + 1) {
+      rtlog_output(slot->site, slot->text);
+      __atomic_store_n(&slot->seq, q_head + RTLOG_QUEUELEN, __ATOMIC_RELEASE);
+      q_head++;
+      continue;
+    }
+
+    //
+    // Queue is empty. Every 100 msec, report the suppressed
+    // messages of all call sites whose window has expired.
+    //
+    uint64_t now = rtlog_now();
+
+    if (now - last_scan > 100000000ULL) {
+      last_scan = now;
+
+      for (RTLOG_SITE *site = __atomic_load_n(&sites, __ATOMIC_ACQUIRE); site; site = site->next) {
+        if (now - __atomic_load_n(&site->window_start, __ATOMIC_ACQUIRE) >= RTLOG_WINDOW) {
+          rtlog_summary(site);
+        }
+      }
+
+      long lost = __atomic_exchange_n(&q_dropped, 0, __ATOMIC_ACQ_REL);
+
+      if (lost > 0) {
+        t_print("rtlog: %ld messages lost (queue full)\n", lost);
+      }
+    }
+
+    usleep(10000);
+  }
+
+  return NULL;
+}
+
+void rtlog_init(void) {
+  if (rtlog_running) { return; }
+
+  for (int i = 0; i < RTLOG_QUEUELEN; i++) {
+    queue[i].seq = i;
+  }
+
+  rtlog_running = 1;
+  rtlog_thread_id = g_thread_new("RT LOG", rtlog_thread, NULL);
+}
+
+void rtlog_print(RTLOG_SITE *site, ...) {
+  va_list args;
+  uint64_t now = rtlog_now();
+  uint64_t ws;
+  rtlog_register(site);
+  ws = __atomic_load_n(&site->window_start, __ATOMIC_ACQUIRE);
+
+  //
+  // Within the current window, or if another thread has just opened
+  // a new window: count only.
+  //
+  if ((ws != 0 && now - ws < RTLOG_WINDOW)
+      || !__atomic_compare_exchange_n(&site->window_start, &ws, now, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    __atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  if (!rtlog_running) {
+    //
+    // Before rtlog_init(), write synchronously
+    //
+    char text[RTLOG_MSGLEN];
+    va_start(args, site);
+    vsnprintf(text, sizeof(text), site->fmt, args);
+    va_end(args);
+    t_print("%s", text);
+    return;
+  }
+
+  //
+  // Claim a slot
+  //
+  uint64_t pos = __atomic_load_n(&q_tail, __ATOMIC_RELAXED);
+  RTLOG_SLOT *slot;
+
+  for (;;) {
+    slot = &queue[pos & (RTLOG_QUEUELEN - 1)];
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+    if (seq == pos) {
+      if (__atomic_compare_exchange_n(&q_tail, &pos, pos + 1, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) { break; }
+    } else if (seq < pos) {
+      // queue full
+      __atomic_fetch_add(&q_dropped, 1, __ATOMIC_RELAXED);
+      return;
+    } else {
+      pos = __atomic_load_n(&q_tail, __ATOMIC_RELAXED);
+    }
+  }
+
+  slot->site = site;
+  va_start(args, site);
+  vsnprintf(slot->text, sizeof(slot->text), site->fmt, args);
+  va_end(args);
+  __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
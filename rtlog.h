@@ -0,0 +1,64 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _RTLOG_H_
+#define _RTLOG_H_
+
+#include <stdint.h>
+
+//
+// Logging from real-time threads.
+//
+// RT_PRINT() has the same arguments as t_print(), but never blocks:
+// the message is formatted into a lock-free queue and written by a
+// background thread. Each call site prints at most one message per
+// second, further messages from the same call site within that second
+// are only counted and reported as "N more messages suppressed" together
+// with the format of the call site (their arguments are not kept).
+//
+// Only use this with a string literal as the format.
+//
+
+typedef struct _rtlog_site {
+  const char          *fmt;
+  struct _rtlog_site  *next;           // list of all sites seen so far
+  int                  registered;
+  uint64_t             window_start;   // nsec, start of current 1-sec window
+  long                 suppressed;     // messages not printed in this window
+  int                  printed;        // a message has been printed (writer thread only)
+} RTLOG_SITE;
+
+extern void rtlog_init(void);
+extern void rtlog_print(RTLOG_SITE *site, ...);
+
+//
+// The format is passed through the site, so the compiler cannot check
+// the arguments of rtlog_print(). The (never executed) call of
+// rtlog_check_format() lets it check them against the format.
+//
+static inline void rtlog_check_format(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static inline void rtlog_check_format(const char *format, ...) { (void) format; }
+
+#define RT_PRINT(format, ...) \
+  do { \
+    static RTLOG_SITE _rtlog_site = { format }; \
+    if (0) { rtlog_check_format(format, ##__VA_ARGS__); } \
+    rtlog_print(&_rtlog_site, ##__VA_ARGS__); \
+  } while (0)
+
+#endif
@@ -0,0 +1,220 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Frequency scanner
+//
+// The scanner runs in the GTK thread, driven by a timer with a period
+// of SCAN_TICK_MS, and is a small state machine:
+//
+// LISTEN:  we are on a channel. If the S-meter exceeds the threshold
+//          (but not before the receiver has settled), go to HOLD.
+//          After the dwell time, hop to the next channel.
+// HOLD:    we stay on the channel as long as there is a signal, and
+//          scan_resume_ms longer. Then hop to the next channel.
+//
+// Hopping uses vfo_id_fast_retune(), which changes the DDC frequency
+// (or, with CTUN, the WDSP shift) and sends a HighPrio packet, but
+// does nothing else. The S-meter is read directly from WDSP, so the
+// scan speed does not depend on the display update rate. The peak
+// meter (RXA_S_PK) is used, which only reflects the most recent DSP
+// buffer: the averaged meter (RXA_S_AV) has a time constant of about
+// 100 msec, so after a strong channel it would still be above the
+// threshold on the next few channels.
+//
+// The dwell time is checked every SCAN_TICK_MS, so a hop takes between
+// scan_dwell_ms and scan_dwell_ms + SCAN_TICK_MS. With the defaults
+// (50 msec dwell) this gives somewhat less than 20 channels per second,
+// at most.
+//
+// Scanning stops when transmitting, and when the VFO is found on
+// another frequency than the current channel (because it has been
+// tuned by other means, or is locked).
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <gtk/gtk.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <wdsp.h>
+
+#include "scanner.h"
+#include "band.h"
+#include "bandstack.h"
+#include "message.h"
+#include "p2trace.h"
+#include "radio.h"
+#include "receiver.h"
+#include "vfo.h"
+
+#define SCAN_TICK_MS      10
+#define SCAN_MAX_CHANNELS 100000
+
+enum {
+  SCAN_LISTEN,
+  SCAN_HOLD
+};
+
+int scan_dwell_ms = 50;
+int scan_settle_ms = 20;
+int scan_resume_ms = 2000;
+double scan_threshold = -100.0;
+
+static long long *channels = NULL;
+static int num_channels = 0;
+static int channel = 0;
+static int scan_id = 0;
+static int scan_state = SCAN_LISTEN;
+static guint scan_timer = 0;
+static gint64 t_hop;               // time of last hop (usec)
+static gint64 t_signal;            // last time a signal has been seen (usec)
+
+static void scanner_hop(void) {
+  channel = (channel + 1) % num_channels;
+  P2TRACE_INSTANT("scan hop", channel);
+  vfo_id_fast_retune(scan_id, channels[channel]);
+  t_hop = g_get_monotonic_time();
+  scan_state = SCAN_LISTEN;
+}
+
+static gboolean scanner_tick(gpointer data) {
+  gint64 now = g_get_monotonic_time();
+  double level;
+
+  if (radio_is_transmitting() || scan_id >= receivers) {
+    scanner_stop();
+    return G_SOURCE_REMOVE;
+  }
+
+  //
+  // If the VFO is no longer on the current channel, it has been tuned
+  // (or locked) by someone else: the user wants the VFO back.
+  //
+  long long f = vfo[scan_id].ctun ? vfo[scan_id].ctun_frequency : vfo[scan_id].frequency;
+
+  if (f != channels[channel]) {
+    t_print("%s: VFO %d has been re-tuned, scan stopped\n", __func__, scan_id);
+    scanner_stop();
+    return G_SOURCE_REMOVE;
+  }
+
+  level = GetRXAMeter(receiver[scan_id]->id, RXA_S_PK);
+
+  switch (scan_state) {
+  case SCAN_LISTEN:
+    if (now - t_hop >= 1000LL * scan_settle_ms && level >= scan_threshold) {
+      t_print("%s: signal on %lld Hz (%0.1f dBm)\n", __func__, channels[channel], level);
+      t_signal = now;
+      scan_state = SCAN_HOLD;
+    } else if (now - t_hop >= 1000LL * scan_dwell_ms) {
+      scanner_hop();
+    }
+
+    break;
+
+  case SCAN_HOLD:
+    if (level >= scan_threshold) {
+      t_signal = now;
+    } else if (now - t_signal >= 1000LL * scan_resume_ms) {
+      scanner_hop();
+    }
+
+    break;
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static int scanner_run(int id) {
+  if (num_channels < 1 || id < 0 || id >= receivers) {
+    scanner_stop();
+    return -1;
+  }
+
+  scan_id = id;
+  channel = num_channels - 1;     // first hop goes to channel 0
+  t_print("%s: scanning %d channels on VFO %d, dwell=%d msec\n", __func__, num_channels, id, scan_dwell_ms);
+  scanner_hop();
+
+  if (scan_timer == 0) {
+    scan_timer = g_timeout_add(SCAN_TICK_MS, scanner_tick, NULL);
+  }
+
+  return 0;
+}
+
+int scanner_start_range(int id, long long start, long long stop, long long step) {
+  long long n;
+
+  if (step <= 0 || stop < start) { return -1; }
+
+  n = (stop - start) / step + 1;
+
+  if (n > SCAN_MAX_CHANNELS) { return -1; }
+
+  g_free(channels);
+  channels = g_new(long long, n);
+  num_channels = (int) n;
+
+  for (int i = 0; i < num_channels; i++) {
+    channels[i] = start + i * step;
+  }
+
+  return scanner_run(id);
+}
+
+int scanner_start_bandstack(int id) {
+  const BANDSTACK *bandstack = bandstack_get_bandstack(vfo[id].band);
+
+  if (bandstack == NULL || bandstack->entries < 1) { return -1; }
+
+  g_free(channels);
+  channels = g_new(long long, bandstack->entries);
+  num_channels = bandstack->entries;
+
+  for (int i = 0; i < num_channels; i++) {
+    channels[i] = bandstack->entry[i].frequency;
+  }
+
+  return scanner_run(id);
+}
+
+int scanner_start_list(int id, const long long *freqs, int n) {
+  if (n < 1 || n > SCAN_MAX_CHANNELS) { return -1; }
+
+  g_free(channels);
+  channels = g_new(long long, n);
+  memcpy(channels, freqs, n * sizeof(long long));
+  num_channels = n;
+  return scanner_run(id);
+}
+
+void scanner_stop(void) {
+  if (scan_timer) {
+    g_source_remove(scan_timer);
+    scan_timer = 0;
+    t_print("%s: scan stopped\n", __func__);
+  }
+}
+
+int scanner_is_running(void) {
+  return scan_timer != 0;
+}
@@ -0,0 +1,46 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _SCANNER_H_
+#define _SCANNER_H_
+
+//
+// Frequency scanner.
+//
+// A scan steps one VFO through a list of channels: a frequency range,
+// the entries of the current bandstack, or a list of frequencies
+// (e.g. a memory bank). On each channel it waits scan_dwell_ms. If the
+// S-meter exceeds scan_threshold (dBm) after scan_settle_ms, the scan
+// stops on that channel, and resumes scan_resume_ms after the signal
+// has dropped below the threshold.
+//
+// All functions must be called from the GTK thread.
+//
+
+extern int scan_dwell_ms;
+extern int scan_settle_ms;
+extern int scan_resume_ms;
+extern double scan_threshold;
+
+extern int  scanner_start_range(int id, long long start, long long stop, long long step);
+extern int  scanner_start_bandstack(int id);
+extern int  scanner_start_list(int id, const long long *freqs, int n);
+extern void scanner_stop(void);
+extern int  scanner_is_running(void);
+
+#endif
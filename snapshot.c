@@ -0,0 +1,607 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Binary settings snapshots
+//
+// Saving the mode settings, band stacks and VFOs as text props costs
+// some ten thousand printf/scanf-formatted keys, which takes seconds
+// on slow SD cards. The snapshot stores the same data as a binary file
+// "<props file>.<what>.snap", which is written with a single
+// g_file_set_contents() (temp file plus rename, so it is never left
+// half-written) and read back through a memory mapping.
+//
+// File layout (native byte order, all parts 8-byte aligned):
+//
+// SNAP_HEADER        magic, version, number of sections, file size, CRC32
+// for each section:
+//   SNAP_FILE_SECTION  name, number of fields, number of records, record size
+//   SNAP_FILE_FIELD[]  name, type, count, offset within the record
+//   records
+//
+// Integers are stored as 64-bit, floating point as double, strings
+// as char arrays. The CRC covers everything after the header.
+//
+// Writing is done in a background thread, so saving never blocks the
+// GTK thread: the GTK thread only serializes the records into an
+// image (a few dozen kB, taking microseconds) and compares it to the
+// previous one; files that did not change are not written at all.
+// Every SNAP_CHECKPOINT_MS, all registered snapshots are checked this
+// way, so that a crash or power loss loses at most a few seconds of
+// changes. Pending writes are flushed at exit.
+//
+// The text props remain the import/export format: if snapshot.text_props
+// is set in the props file, they are written by an explicit save (and
+// read, taking precedence, so they can be edited by hand). Otherwise
+// they are only read if there is no valid snapshot, and only written
+// as a fall-back if the snapshot could not be written. An explicit save
+// (radio_save_state) therefore waits for the snapshot to be written.
+// The periodic checkpoints never wait and only write snapshots.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <gtk/gtk.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "snapshot.h"
+#include "message.h"
+#include "property.h"
+#include "radio.h"
+
+#define SNAP_MAGIC    "DHSNAP\r\n"
+#define SNAP_VERSION  1
+#define SNAP_ALIGN(x) (((x) + 7) & ~((size_t) 7))
+#define SNAP_MAX_STORES     8
+#define SNAP_MAX_PREPARE    4
+#define SNAP_CHECKPOINT_MS  5000
+
+enum {
+  SNAP_F_INT64,
+  SNAP_F_DOUBLE,
+  SNAP_F_STRING
+};
+
+typedef struct _snap_header {
+  char     magic[8];
+  uint32_t version;
+  uint32_t nsec;
+  uint32_t size;
+  uint32_t crc;
+} SNAP_HEADER;
+
+typedef struct _snap_file_section {
+  char     name[32];
+  uint32_t nfields;
+  uint32_t nrec;
+  uint32_t recsize;
+  uint32_t reserved;
+} SNAP_FILE_SECTION;
+
+typedef struct _snap_file_field {
+  char     name[32];
+  uint32_t type;
+  uint32_t count;
+  uint32_t offset;
+  uint32_t size;                 // size of one element
+} SNAP_FILE_FIELD;
+
+//
+// One store per snapshot file. "last" is the image most recently
+// handed to the writer thread (or read at startup), "pending" is the
+// image the writer thread has yet to write.
+//
+typedef struct _snap_store {
+  char              what[16];
+  SNAP_SECTIONS_FN  sections;
+  GByteArray       *last;       // GTK thread only
+  GByteArray       *pending;    // protected by snap_mutex
+  int               failed;     // last write failed, protected by snap_mutex
+} SNAP_STORE;
+
+int snapshot_text_props = 0;
+
+static SNAP_STORE stores[SNAP_MAX_STORES];
+static int num_stores = 0;
+static SNAP_PREPARE_FN prepares[SNAP_MAX_PREPARE];
+static int num_prepares = 0;
+static GMutex snap_mutex;
+static GCond snap_cond;
+static GThread *snap_writer = NULL;
+static int snap_busy = 0;
+static guint snap_timer = 0;
+
+static uint32_t crc_table[256];
+
+static uint32_t snap_crc32(const unsigned char *p, size_t len) {
+  uint32_t crc = 0xFFFFFFFF;
+
+  if (crc_table[1] == 0) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      }
+
+      crc_table[i] = c;
+    }
+  }
+
+  while (len--) {
+    crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  }
+
+  return crc ^ 0xFFFFFFFF;
+}
+
+static char *snap_filename(const char *what) {
+  return g_strdup_printf("%s.%s.snap", property_path, what);
+}
+
+static int snap_file_type(const SNAP_FIELD *f) {
+  switch (f->kind) {
+  case SNAP_DOUBLE:
+    return SNAP_F_DOUBLE;
+
+  case SNAP_STRING:
+    return SNAP_F_STRING;
+
+  default:
+    return SNAP_F_INT64;
+  }
+}
+
+static gint64 snap_get_int(const char *p, const SNAP_FIELD *f) {
+  switch (f->size) {
+  case 1:
+    return f->kind == SNAP_UINT ? (gint64) * (const guint8 *) p : (gint64) * (const gint8 *) p;
+
+  case 2:
+    return f->kind == SNAP_UINT ? (gint64) * (const guint16 *) p : (gint64) * (const gint16 *) p;
+
+  case 4:
+    return f->kind == SNAP_UINT ? (gint64) * (const guint32 *) p : (gint64) * (const gint32 *) p;
+
+  default:
+    return *(const gint64 *) p;
+  }
+}
+
+static void snap_set_int(char *p, const SNAP_FIELD *f, gint64 v) {
+  switch (f->size) {
+  case 1:
+    *(gint8 *) p = (gint8) v;
+    break;
+
+  case 2:
+    *(gint16 *) p = (gint16) v;
+    break;
+
+  case 4:
+    *(gint32 *) p = (gint32) v;
+    break;
+
+  default:
+    *(gint64 *) p = v;
+    break;
+  }
+}
+
+static double snap_get_double(const char *p, const SNAP_FIELD *f) {
+  if (f->kind != SNAP_DOUBLE) { return (double) snap_get_int(p, f); }
+
+  return f->size == sizeof(float) ? *(const float *) p : *(const double *) p;
+}
+
+static void snap_set_double(char *p, const SNAP_FIELD *f, double v) {
+  if (f->kind != SNAP_DOUBLE) {
+    snap_set_int(p, f, (gint64) v);
+  } else if (f->size == sizeof(float)) {
+    *(float *) p = (float) v;
+  } else {
+    *(double *) p = v;
+  }
+}
+
+static size_t snap_file_size(const SNAP_FIELD *f) {
+  return f->kind == SNAP_STRING ? SNAP_ALIGN(f->size) : 8 * (size_t) f->count;
+}
+
+static GByteArray *snap_build(const SNAP_SECTION *sec, int nsec) {
+  GByteArray *buf = g_byte_array_new();
+  SNAP_HEADER hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic));
+  hdr.version = SNAP_VERSION;
+  hdr.nsec = nsec;
+  g_byte_array_append(buf, (const guint8 *) &hdr, sizeof(hdr));
+
+  for (int s = 0; s < nsec; s++) {
+    SNAP_FILE_SECTION fs;
+    SNAP_FILE_FIELD ff;
+    size_t recsize = 0;
+    memset(&fs, 0, sizeof(fs));
+    g_strlcpy(fs.name, sec[s].name, sizeof(fs.name));
+    fs.nfields = sec[s].nfields;
+    fs.nrec = sec[s].nrec;
+
+    for (int i = 0; i < sec[s].nfields; i++) {
+      recsize += snap_file_size(&sec[s].fields[i]);
+    }
+
+    fs.recsize = recsize;
+    g_byte_array_append(buf, (const guint8 *) &fs, sizeof(fs));
+    recsize = 0;
+
+    for (int i = 0; i < sec[s].nfields; i++) {
+      const SNAP_FIELD *f = &sec[s].fields[i];
+      memset(&ff, 0, sizeof(ff));
+      g_strlcpy(ff.name, f->name, sizeof(ff.name));
+      ff.type = snap_file_type(f);
+      ff.count = f->count;
+      ff.offset = recsize;
+      ff.size = f->kind == SNAP_STRING ? f->size : 8;
+      g_byte_array_append(buf, (const guint8 *) &ff, sizeof(ff));
+      recsize += snap_file_size(f);
+    }
+
+    for (int r = 0; r < sec[s].nrec; r++) {
+      const char *rec = sec[s].base + r * sec[s].stride;
+
+      for (int i = 0; i < sec[s].nfields; i++) {
+        const SNAP_FIELD *f = &sec[s].fields[i];
+        const char *p = rec + f->offset;
+
+        if (f->kind == SNAP_STRING) {
+          char str[SNAP_ALIGN(f->size)];
+          memset(str, 0, sizeof(str));
+          memcpy(str, p, strnlen(p, f->size));
+          g_byte_array_append(buf, (const guint8 *) str, sizeof(str));
+          continue;
+        }
+
+        for (int j = 0; j < f->count; j++, p += f->size) {
+          if (f->kind == SNAP_DOUBLE) {
+            double d = snap_get_double(p, f);
+            g_byte_array_append(buf, (const guint8 *) &d, sizeof(d));
+          } else {
+            gint64 v = snap_get_int(p, f);
+            g_byte_array_append(buf, (const guint8 *) &v, sizeof(v));
+          }
+        }
+      }
+    }
+  }
+
+  hdr.size = buf->len;
+  hdr.crc = snap_crc32(buf->data + sizeof(hdr), buf->len - sizeof(hdr));
+  memcpy(buf->data, &hdr, sizeof(hdr));
+
+  return buf;
+}
+
+static SNAP_STORE *snap_store(const char *what) {
+  //
+  // Find (or create) the store for a snapshot file (GTK thread only)
+  //
+  for (int i = 0; i < num_stores; i++) {
+    if (!strcmp(stores[i].what, what)) { return &stores[i]; }
+  }
+
+  if (num_stores >= SNAP_MAX_STORES) {
+    t_print("%s: too many snapshot files, %s not saved\n", __func__, what);
+    return NULL;
+  }
+
+  g_mutex_lock(&snap_mutex);
+  SNAP_STORE *store = &stores[num_stores];
+  g_strlcpy(store->what, what, sizeof(store->what));
+  num_stores++;
+  g_mutex_unlock(&snap_mutex);
+  return store;
+}
+
+static gpointer snap_writer_thread(gpointer data) {
+  g_mutex_lock(&snap_mutex);
+
+  for (;;) {
+    SNAP_STORE *store = NULL;
+
+    for (int i = 0; i < num_stores; i++) {
+      if (stores[i].pending) {
+        store = &stores[i];
+        break;
+      }
+    }
+
+    if (store == NULL) {
+      g_cond_wait(&snap_cond, &snap_mutex);
+      continue;
+    }
+
+    GByteArray *buf = store->pending;
+    char *fname = snap_filename(store->what);
+    GError *error = NULL;
+    int failed = 0;
+    store->pending = NULL;
+    snap_busy = 1;
+    g_mutex_unlock(&snap_mutex);
+
+    if (!g_file_set_contents(fname, (const gchar *) buf->data, buf->len, &error)) {
+      t_print("%s: cannot write %s: %s\n", __func__, fname, error->message);
+      g_error_free(error);
+      failed = 1;
+    }
+
+    g_byte_array_unref(buf);
+    g_free(fname);
+    g_mutex_lock(&snap_mutex);
+    store->failed = failed;
+    snap_busy = 0;
+    g_cond_broadcast(&snap_cond);
+  }
+
+  return NULL;
+}
+
+static void snap_queue(SNAP_STORE *store, GByteArray *buf) {
+  //
+  // Hand the image over to the writer thread, unless it is
+  // identical to the one handed over last time. If an older image
+  // is still waiting, it is replaced. After a failed write, the image
+  // is handed over again even if it did not change.
+  //
+  g_mutex_lock(&snap_mutex);
+  int failed = store->failed;
+  g_mutex_unlock(&snap_mutex);
+
+  if (!failed && store->last && store->last->len == buf->len && !memcmp(store->last->data, buf->data, buf->len)) {
+    g_byte_array_unref(buf);
+    return;
+  }
+
+  if (store->last) { g_byte_array_unref(store->last); }
+
+  store->last = g_byte_array_ref(buf);
+  g_mutex_lock(&snap_mutex);
+
+  if (snap_writer == NULL) {
+    snap_writer = g_thread_new("SNAPSHOT", snap_writer_thread, NULL);
+    atexit(snapshot_flush);
+  }
+
+  if (store->pending) { g_byte_array_unref(store->pending); }
+
+  store->pending = buf;
+  g_cond_broadcast(&snap_cond);
+  g_mutex_unlock(&snap_mutex);
+}
+
+static gboolean snap_checkpoint_cb(gpointer data) {
+  snapshot_checkpoint();
+  return G_SOURCE_CONTINUE;
+}
+
+void snapshot_checkpoint(void) {
+  SNAP_SECTION sec[SNAP_MAX_SECTIONS];
+
+  for (int i = 0; i < num_prepares; i++) {
+    prepares[i]();
+  }
+
+  for (int i = 0; i < num_stores; i++) {
+    if (stores[i].sections) {
+      int nsec = stores[i].sections(sec);
+      snap_queue(&stores[i], snap_build(sec, nsec));
+    }
+  }
+}
+
+void snapshot_register(const char *what, SNAP_SECTIONS_FN sections) {
+  SNAP_STORE *store = snap_store(what);
+
+  if (store) { store->sections = sections; }
+
+  if (snap_timer == 0) {
+    snap_timer = g_timeout_add(SNAP_CHECKPOINT_MS, snap_checkpoint_cb, NULL);
+  }
+}
+
+void snapshot_add_prepare(SNAP_PREPARE_FN prepare) {
+  for (int i = 0; i < num_prepares; i++) {
+    if (prepares[i] == prepare) { return; }
+  }
+
+  if (num_prepares >= SNAP_MAX_PREPARE) {
+    t_print("%s: too many prepare functions\n", __func__);
+    return;
+  }
+
+  prepares[num_prepares++] = prepare;
+}
+
+void snapshot_flush(void) {
+  int waiting;
+  g_mutex_lock(&snap_mutex);
+
+  do {
+    waiting = snap_busy;
+
+    for (int i = 0; i < num_stores; i++) {
+      if (stores[i].pending) { waiting = 1; }
+    }
+
+    if (waiting) { g_cond_wait(&snap_cond, &snap_mutex); }
+  } while (waiting);
+
+  g_mutex_unlock(&snap_mutex);
+}
+
+int snapshot_save(const char *what, const SNAP_SECTION *sec, int nsec) {
+  SNAP_STORE *store = snap_store(what);
+  int failed;
+  SetPropI0("snapshot.text_props", snapshot_text_props);
+
+  if (store == NULL) { return 1; }
+
+  snap_queue(store, snap_build(sec, nsec));
+  //
+  // An explicit save waits for the write, so that the text props can
+  // be written instead if it fails
+  //
+  snapshot_flush();
+  g_mutex_lock(&snap_mutex);
+  failed = store->failed;
+  g_mutex_unlock(&snap_mutex);
+
+  if (failed) { t_print("%s: %s snapshot not written, saving text props instead\n", __func__, what); }
+
+  return failed || snapshot_text_props;
+}
+
+static void snap_load_section(const SNAP_SECTION *sec, const SNAP_FILE_SECTION *fs,
+                              const SNAP_FILE_FIELD *ff, const char *records) {
+  int nrec = MIN((int) fs->nrec, sec->nrec);
+
+  for (int i = 0; i < sec->nfields; i++) {
+    const SNAP_FIELD *f = &sec->fields[i];
+    const SNAP_FILE_FIELD *src = NULL;
+
+    for (uint32_t k = 0; k < fs->nfields; k++) {
+      if (!strncmp(ff[k].name, f->name, sizeof(ff[k].name))) {
+        src = &ff[k];
+        break;
+      }
+    }
+
+    //
+    // Fields not in the file keep their default value.
+    // Strings and numbers cannot be converted into each other.
+    //
+    if (src == NULL || (src->type == SNAP_F_STRING) != (f->kind == SNAP_STRING)) { continue; }
+
+    for (int r = 0; r < nrec; r++) {
+      const char *q = records + r * fs->recsize + src->offset;
+      char *p = sec->base + r * sec->stride + f->offset;
+
+      if (f->kind == SNAP_STRING) {
+        size_t n = MIN(strnlen(q, src->size), f->size - 1);
+        memcpy(p, q, n);
+        p[n] = 0;
+        continue;
+      }
+
+      for (int j = 0; j < MIN(f->count, (int) src->count); j++, p += f->size, q += 8) {
+        if (src->type == SNAP_F_DOUBLE) {
+          snap_set_double(p, f, *(const double *) q);
+        } else {
+          snap_set_int(p, f, *(const gint64 *) q);
+        }
+      }
+    }
+  }
+}
+
+static int snap_load(const char *what, const SNAP_SECTION *sec, int nsec) {
+  char *fname = snap_filename(what);
+  GMappedFile *map = g_mapped_file_new(fname, FALSE, NULL);
+  const char *data;
+  size_t len, pos;
+  SNAP_HEADER hdr;
+  SNAP_STORE *store;
+  int rc = -1;
+
+  if (map == NULL) {
+    t_print("%s: no snapshot %s\n", __func__, fname);
+    g_free(fname);
+    return -1;
+  }
+
+  data = g_mapped_file_get_contents(map);
+  len = g_mapped_file_get_length(map);
+
+  if (len < sizeof(hdr)) { goto out; }
+
+  memcpy(&hdr, data, sizeof(hdr));
+
+  if (memcmp(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic)) || hdr.version != SNAP_VERSION || hdr.size != len
+      || hdr.crc != snap_crc32((const unsigned char *) data + sizeof(hdr), len - sizeof(hdr))) {
+    goto out;
+  }
+
+  pos = sizeof(hdr);
+
+  for (uint32_t s = 0; s < hdr.nsec; s++) {
+    const SNAP_FILE_SECTION *fs = (const SNAP_FILE_SECTION *) (data + pos);
+    const SNAP_FILE_FIELD *ff;
+
+    if (pos + sizeof(*fs) > len) { goto out; }
+
+    pos += sizeof(*fs);
+    ff = (const SNAP_FILE_FIELD *) (data + pos);
+
+    if (pos + fs->nfields * sizeof(*ff) + (size_t) fs->nrec * fs->recsize > len) { goto out; }
+
+    pos += fs->nfields * sizeof(*ff);
+
+    for (uint32_t k = 0; k < fs->nfields; k++) {
+      size_t fsize = ff[k].type == SNAP_F_STRING ? SNAP_ALIGN(ff[k].size) : 8 * (size_t) ff[k].count;
+
+      if (ff[k].offset + fsize > fs->recsize) { goto out; }
+    }
+
+    for (int i = 0; i < nsec; i++) {
+      if (!strncmp(sec[i].name, fs->name, sizeof(fs->name))) {
+        snap_load_section(&sec[i], fs, ff, data + pos);
+        break;
+      }
+    }
+
+    pos += (size_t) fs->nrec * fs->recsize;
+  }
+
+  //
+  // What is in the file need not be written again
+  //
+  if ((store = snap_store(what)) && store->last == NULL) {
+    store->last = g_byte_array_sized_new(len);
+    g_byte_array_append(store->last, (const guint8 *) data, len);
+  }
+
+  rc = 0;
+out:
+
+  if (rc < 0) {
+    t_print("%s: %s is invalid or corrupt, ignored\n", __func__, fname);
+  }
+
+  g_mapped_file_unref(map);
+  g_free(fname);
+  return rc;
+}
+
+int snapshot_restore(const char *what, const SNAP_SECTION *sec, int nsec) {
+  GetPropI0("snapshot.text_props", snapshot_text_props);
+
+  if (snap_load(what, sec, nsec) < 0) { return 1; }
+
+  return snapshot_text_props;
+}
@@ -0,0 +1,116 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <stddef.h>
+
+//
+// Binary settings snapshots.
+//
+// A snapshot file contains one or more sections, each section is an
+// array of records (e.g. mode_settings[]). The layout of the records
+// is described by a table of SNAP_FIELDs, and this description is
+// stored in the file as well. Upon reading, fields are matched by
+// name, so fields may be added, removed or re-ordered in the structs,
+// and the number of records may change, without invalidating the file.
+//
+// SNAP_VAL:  scalar member (any integer type, float or double)
+// SNAP_ARR:  array member of scalars
+// SNAP_STR:  char array member
+//
+
+enum _snap_kind {
+  SNAP_INT,
+  SNAP_UINT,
+  SNAP_DOUBLE,
+  SNAP_STRING
+};
+
+typedef struct _snap_field {
+  const char *name;
+  int         kind;
+  size_t      offset;
+  size_t      size;              // size of one element
+  int         count;             // number of elements
+} SNAP_FIELD;
+
+typedef struct _snap_section {
+  char              name[32];
+  const SNAP_FIELD *fields;
+  int               nfields;
+  char             *base;        // first record
+  size_t            stride;      // distance between records
+  int               nrec;
+} SNAP_SECTION;
+
+#define SNAP_MEMBER(s, f) (((s *)0)->f)
+
+#define SNAP_KIND(x) _Generic((x), \
+  float: SNAP_DOUBLE, double: SNAP_DOUBLE, \
+  unsigned char: SNAP_UINT, unsigned short: SNAP_UINT, \
+  unsigned int: SNAP_UINT, unsigned long: SNAP_UINT, unsigned long long: SNAP_UINT, \
+  default: SNAP_INT)
+
+#define SNAP_VAL(s, f) { #f, SNAP_KIND(SNAP_MEMBER(s, f)), offsetof(s, f), sizeof(SNAP_MEMBER(s, f)), 1 }
+#define SNAP_ARR(s, f) { #f, SNAP_KIND(SNAP_MEMBER(s, f)[0]), offsetof(s, f), sizeof(SNAP_MEMBER(s, f)[0]), \
+                         sizeof(SNAP_MEMBER(s, f)) / sizeof(SNAP_MEMBER(s, f)[0]) }
+#define SNAP_STR(s, f) { #f, SNAP_STRING, offsetof(s, f), sizeof(SNAP_MEMBER(s, f)), 1 }
+
+#define SNAP_NFIELDS(t) (int)(sizeof(t) / sizeof(t[0]))
+
+#define SNAP_MAX_SECTIONS 128
+
+//
+// Callback that fills in the sections of a snapshot file (at most
+// SNAP_MAX_SECTIONS) and returns their number. It is called from the
+// GTK thread for the periodic checkpoints.
+//
+typedef int (*SNAP_SECTIONS_FN)(SNAP_SECTION *sec);
+
+extern int snapshot_text_props;
+
+//
+// snapshot_save() writes the snapshot (if it has changed) and returns 1
+// if the text props should be written as well (export enabled, or the
+// snapshot could not be written).
+// snapshot_restore() reads the snapshot and returns 1 if the text props
+// should be read as well (no valid snapshot, or text props enabled).
+//
+extern int snapshot_save(const char *what, const SNAP_SECTION *sec, int nsec);
+extern int snapshot_restore(const char *what, const SNAP_SECTION *sec, int nsec);
+
+//
+// snapshot_register() includes a snapshot file in the periodic
+// checkpoints, snapshot_checkpoint() does a checkpoint right now, and
+// snapshot_flush() waits until all pending writes are done.
+//
+// snapshot_add_prepare() registers a function that is called at the
+// start of each checkpoint, before any sections are collected. It can
+// fold state that is kept elsewhere into the snapshotted data (e.g.
+// the VFO state into the current bandstack entry).
+//
+typedef void (*SNAP_PREPARE_FN)(void);
+
+extern void snapshot_register(const char *what, SNAP_SECTIONS_FN sections);
+extern void snapshot_add_prepare(SNAP_PREPARE_FN prepare);
+extern void snapshot_checkpoint(void);
+extern void snapshot_flush(void);
+
+#endif
@@ -0,0 +1,240 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Spectrum-only receivers
+//
+// The IQ samples are collected into blocks of buffer_size complex
+// samples and passed to a WDSP analyzer with Spectrum0(). The analyzer
+// does the windowed FFT and the (log-recursive) averaging. Its overlap
+// is chosen such that only fps spectra per second are computed, so the
+// CPU load is determined by the display rate and not by the sample rate.
+// The analyzer ids start at SPECTRUM_RX_DISPLAY, well above those used
+// for the RX and TX channels.
+//
+// A spectrum receiver gets a DDC of its own when it is created, and
+// keeps it until it is destroyed. Creating it is refused if the radio
+// has no free DDC or does not support the sample rate. Both creating
+// and destroying it are done within a protocol reconfiguration, which
+// waits until no IQ worker can still use it, and discards the packets
+// the DDC still produces with its old settings.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <gtk/gtk.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <wdsp.h>
+
+#include "spectrum_rx.h"
+#include "message.h"
+#include "new_protocol.h"
+#include "radio.h"
+
+#define SPECTRUM_RX_DISPLAY     32
+#define SPECTRUM_RX_FFT_SIZE    4096
+#define SPECTRUM_RX_BUFFER_SIZE 1024
+
+//
+// WDSP display detector and averaging modes
+//
+#define SPECTRUM_RX_DETECTOR_AVERAGE 2
+#define SPECTRUM_RX_AVERAGE_LOG_REC  3
+
+SPECTRUM_RX *spectrum_rx[MAX_SPECTRUM_RX] = { NULL };
+
+static int spectrum_rx_valid_rate(int sample_rate) {
+  //
+  // P2 DDC sample rates are 48000 * 2^k, up to 1536000
+  //
+  for (int rate = 48000; rate <= 1536000; rate *= 2) {
+    if (sample_rate == rate) { return 1; }
+  }
+
+  return 0;
+}
+
+static void spectrum_rx_init_analyzer(SPECTRUM_RX *srx) {
+  int flp[] = {0};
+  double keep_time = 0.1;
+  int overlap;
+  int max_w;
+  double t = 0.001 * srx->average_time;
+  overlap = (int) fmax(0.0, ceil(srx->fft_size - (double)srx->sample_rate / (double)srx->fps));
+  max_w = srx->fft_size + (int) fmin(keep_time * (double) srx->fps, keep_time * (double) srx->fft_size * (double) srx->fps);
+  SetAnalyzer(srx->display,
+              1,                 // n_pixout
+              1,                 // spur elimination FFTs
+              1,                 // complex data
+              flp,
+              srx->fft_size,
+              srx->buffer_size,
+              5,                 // window: Kaiser
+              14.0,              // Kaiser PiAlpha
+              overlap,
+              0,                 // clip
+              0,                 // span clip low
+              0,                 // span clip high
+              srx->pixels,
+              1,                 // stitches
+              0,                 // calibration data set
+              0.0,               // span min freq
+              0.0,               // span max freq
+              max_w);
+  SetDisplayDetectorMode(srx->display, 0, SPECTRUM_RX_DETECTOR_AVERAGE);
+  SetDisplayAverageMode(srx->display, 0, SPECTRUM_RX_AVERAGE_LOG_REC);
+  SetDisplayAvBackmult(srx->display, 0, exp(-1.0 / ((double)srx->fps * t)));
+  SetDisplayNumAverage(srx->display, 0, (int) fmax(2.0, fmin(60.0, (double)srx->fps * t)));
+}
+
+SPECTRUM_RX *spectrum_rx_create(int adc, int sample_rate, long long frequency, int pixels, int fps) {
+  SPECTRUM_RX *srx;
+  int id = -1;
+  int ddc;
+  int rc;
+
+  //
+  // The DDC assignment is only done by the P2 protocol
+  //
+  if (protocol != NEW_PROTOCOL || pixels < 1 || fps < 1) {
+    return NULL;
+  }
+
+  if (!spectrum_rx_valid_rate(sample_rate)) {
+    t_print("%s: sample rate %d not supported\n", __func__, sample_rate);
+    return NULL;
+  }
+
+  if ((ddc = new_protocol_spectrum_ddc()) < 0) {
+    t_print("%s: no free DDC\n", __func__);
+    return NULL;
+  }
+
+  for (int i = 0; i < MAX_SPECTRUM_RX; i++) {
+    if (spectrum_rx[i] == NULL) {
+      id = i;
+      break;
+    }
+  }
+
+  if (id < 0) {
+    t_print("%s: all %d spectrum receivers in use\n", __func__, MAX_SPECTRUM_RX);
+    return NULL;
+  }
+
+  srx = g_new0(SPECTRUM_RX, 1);
+  srx->id = id;
+  srx->ddc = ddc;
+  srx->display = SPECTRUM_RX_DISPLAY + id;
+  srx->adc = adc;
+  srx->sample_rate = sample_rate;
+  srx->frequency = frequency;
+  srx->fps = fps;
+  srx->average_time = 250;
+  srx->pixels = pixels;
+  srx->fft_size = SPECTRUM_RX_FFT_SIZE;
+  srx->buffer_size = SPECTRUM_RX_BUFFER_SIZE;
+  srx->iq_input_buffer = g_new0(double, 2 * srx->buffer_size);
+  srx->pixel_samples = g_new0(float, pixels);
+  XCreateAnalyzer(srx->display, &rc, 262144, 1, 1, "");
+
+  if (rc != 0) {
+    t_print("%s: XCreateAnalyzer id=%d failed: %d\n", __func__, srx->display, rc);
+    g_free(srx->iq_input_buffer);
+    g_free(srx->pixel_samples);
+    g_free(srx);
+    return NULL;
+  }
+
+  spectrum_rx_init_analyzer(srx);
+  t_print("%s: id=%d ddc=%d adc=%d rate=%d freq=%lld\n", __func__, id, ddc, adc, sample_rate, frequency);
+  //
+  // Publish within a reconfiguration, such that the DDC is flushed
+  // until the radio runs it with the new settings.
+  //
+  new_protocol_reconfigure_begin();
+  __atomic_store_n(&spectrum_rx[id], srx, __ATOMIC_RELEASE);
+  new_protocol_reconfigure_end();
+  return srx;
+}
+
+void spectrum_rx_destroy(SPECTRUM_RX *srx) {
+  if (srx == NULL) { return; }
+
+  new_protocol_reconfigure_begin();
+  __atomic_store_n(&spectrum_rx[srx->id], NULL, __ATOMIC_RELEASE);
+  new_protocol_reconfigure_end();
+  DestroyAnalyzer(srx->display);
+  g_free(srx->iq_input_buffer);
+  g_free(srx->pixel_samples);
+  g_free(srx);
+}
+
+void spectrum_rx_set_frequency(SPECTRUM_RX *srx, long long frequency) {
+  __atomic_store_n(&srx->frequency, frequency, __ATOMIC_RELEASE);
+  schedule_high_priority();
+}
+
+void spectrum_rx_add_iq_samples(SPECTRUM_RX *srx, const double *iq, int n) {
+  //
+  // iq contains n complex samples (I and Q interleaved)
+  //
+  while (n > 0) {
+    int chunk = srx->buffer_size - srx->samples;
+
+    if (chunk > n) { chunk = n; }
+
+    memcpy(&srx->iq_input_buffer[2 * srx->samples], iq, 2 * chunk * sizeof(double));
+    srx->samples += chunk;
+    iq += 2 * chunk;
+    n -= chunk;
+
+    if (srx->samples >= srx->buffer_size) {
+      Spectrum0(1, srx->display, 0, 0, srx->iq_input_buffer);
+      srx->samples = 0;
+    }
+  }
+}
+
+int spectrum_rx_get_pixels(SPECTRUM_RX *srx) {
+  int flag = 0;
+  GetPixels(srx->display, 0, srx->pixel_samples, &flag);
+  return flag;
+}
+
+int spectrum_rx_peak(SPECTRUM_RX *srx, long long *frequency, double *dbfs) {
+  int peak = 0;
+
+  //
+  // Frequency and level of the strongest pixel of the most recent
+  // spectrum. The analyzer has no calibration, so the level is
+  // relative to the full scale of the DDC (dBFS), not dBm.
+  //
+  spectrum_rx_get_pixels(srx);
+
+  for (int i = 1; i < srx->pixels; i++) {
+    if (srx->pixel_samples[i] > srx->pixel_samples[peak]) { peak = i; }
+  }
+
+  *frequency = srx->frequency + (long long)((((double)peak + 0.5) / srx->pixels - 0.5) * srx->sample_rate);
+  *dbfs = srx->pixel_samples[peak];
+  return peak;
+}
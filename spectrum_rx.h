@@ -0,0 +1,72 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _SPECTRUM_RX_H_
+#define _SPECTRUM_RX_H_
+
+//
+// Spectrum-only receivers.
+//
+// A spectrum receiver occupies a DDC of its own (with the P2 protocol,
+// one of the DDCs following those of the normal receivers, kept for
+// its lifetime), but its samples only go to a WDSP analyzer: there is
+// no RXA channel, hence no demodulation, AGC, noise reduction or audio. This is meant for
+// watching additional bands on spare DDCs.
+//
+// Note the RX band-pass filters are set by the normal receivers, so
+// watching another band requires an ADC whose filters are bypassed.
+//
+// Levels are in dBFS, since the analyzer is not calibrated.
+//
+// spectrum_rx_create() returns NULL unless the P2 protocol is running,
+// a DDC is free, and the sample rate is one of 48000 * 2^k (k = 0...5).
+//
+// spectrum_rx_create/destroy/set_frequency/get_pixels/peak must be
+// called from the GTK thread, spectrum_rx_add_iq_samples() is called
+// from the protocol layer.
+//
+
+#define MAX_SPECTRUM_RX 4
+
+typedef struct _spectrum_rx {
+  int id;                  // slot in spectrum_rx[]
+  int ddc;                 // P2 DDC, fixed at creation
+  int display;             // WDSP analyzer
+  int adc;
+  int sample_rate;
+  long long frequency;     // DDC (center) frequency
+  int fps;                 // spectra per second
+  int average_time;        // msec
+  int pixels;
+  int fft_size;
+  int buffer_size;         // complex samples per call to Spectrum0()
+  int samples;             // complex samples in iq_input_buffer
+  double *iq_input_buffer;
+  float *pixel_samples;
+} SPECTRUM_RX;
+
+extern SPECTRUM_RX *spectrum_rx[MAX_SPECTRUM_RX];
+
+extern SPECTRUM_RX *spectrum_rx_create(int adc, int sample_rate, long long frequency, int pixels, int fps);
+extern void spectrum_rx_destroy(SPECTRUM_RX *srx);
+extern void spectrum_rx_set_frequency(SPECTRUM_RX *srx, long long frequency);
+extern void spectrum_rx_add_iq_samples(SPECTRUM_RX *srx, const double *iq, int n);
+extern int  spectrum_rx_get_pixels(SPECTRUM_RX *srx);
+extern int  spectrum_rx_peak(SPECTRUM_RX *srx, long long *frequency, double *dbfs);
+
+#endif
@@ -59,7 +59,9 @@
 #include "noise_menu.h"
 #include "equalizer_menu.h"
 #include "message.h"
+#include "p2trace.h"
 #include "sliders.h"
+#include "snapshot.h"
 #include "audio.h"
 #include "wdsp.h"
 
@@ -70,7 +72,14 @@ static int my_width;
 static int my_height;
 
 static GtkWidget *vfo_panel;
-static cairo_surface_t *vfo_surface = NULL;
+static int vfo_surface_width = 0;       // size of the VFO bar, zero if not (yet) shown
+static int vfo_surface_height = 0;
+static int vfo_damage_all = 1;          // re-draw the whole VFO bar upon next vfo_update()
+static gint64 vfo_last_render = 0;      // time of last re-draw (usec, monotonic)
+static guint vfo_render_timer = 0;      // pending deferred re-draw
+
+int vfo_fps = 30;                       // max. re-draws of the VFO bar per second
+int vfo_accel = 0;                      // velocity-dependent acceleration of VFO steps
 
 int steps[] = {1, 10, 25, 50, 100, 250, 500, 1000, 5000, 6250, 9000, 10000, 12500, 100000, 250000, 500000, 1000000};
 char *step_labels[] = {"1Hz", "10Hz", "25Hz", "50Hz", "100Hz", "250Hz", "500Hz", "1kHz",
@@ -93,6 +102,84 @@ static inline long long ROUND(long long freq, int nsteps, int step) {
 struct _vfo vfo[MAX_VFOS];
 struct _mode_settings mode_settings[MODES];
 
+//
+// The vfo[] array is modified by the GTK thread, but read by the
+// threads that build the protocol packets. These get a consistent copy
+// through vfo_snapshot(), which reads a published copy of vfo[]
+// protected by a sequence lock: vfo_seq is odd while vfo_publish()
+// writes the copy, and readers retry if it was odd or has changed
+// while they copied. Readers never block the writer.
+//
+// vfo_seq / 2 is the version number of the snapshot, which increases
+// with every vfo_publish() and can be used for change detection.
+//
+// Which VFO is the RX (active receiver) and which the TX VFO (split)
+// is published with vfo[], so a snapshot also tells which of its
+// entries govern the RX and TX frequencies.
+//
+// vfo[] is only written by the GTK thread, so only the GTK thread may
+// publish it: a copy taken elsewhere could catch a half-done update.
+// vfo_publish() is called by schedule_high_priority() (which hands
+// calls from other threads over to the GTK thread), and when the VFO
+// bar is updated (which all functions that change the VFO state
+// request).
+//
+static struct _vfo vfo_published[MAX_VFOS];
+static int vfo_published_rx = VFO_A;
+static int vfo_published_tx = VFO_A;
+static unsigned int vfo_seq = 0;
+
+static void vfo_current_ids(int *rxvfo, int *txvfo) {
+  //
+  // active_receiver does not yet exist while the VFO state is restored
+  //
+  int rx = active_receiver ? active_receiver->id : VFO_A;
+
+  if (rx >= MAX_VFOS) { rx = VFO_A; }
+
+  *rxvfo = rx;
+  *txvfo = split ? 1 - rx : rx;
+}
+
+void vfo_publish(void) {
+  int rx, tx;
+  vfo_current_ids(&rx, &tx);
+  unsigned int seq = __atomic_load_n(&vfo_seq, __ATOMIC_RELAXED);
+  __atomic_store_n(&vfo_seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(vfo_published, vfo, sizeof(vfo_published));
+  vfo_published_rx = rx;
+  vfo_published_tx = tx;
+  __atomic_store_n(&vfo_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+unsigned int vfo_snapshot(struct _vfo *snap, int *rxvfo, int *txvfo) {
+  unsigned int seq1, seq2;
+
+  for (;;) {
+    seq1 = __atomic_load_n(&vfo_seq, __ATOMIC_ACQUIRE);
+
+    if (seq1 == 0) {
+      //
+      // Nothing published yet (during start-up)
+      //
+      memcpy(snap, vfo, sizeof(vfo_published));
+      vfo_current_ids(rxvfo, txvfo);
+      return 0;
+    }
+
+    if (seq1 & 1) { continue; }
+
+    memcpy(snap, vfo_published, sizeof(vfo_published));
+    *rxvfo = vfo_published_rx;
+    *txvfo = vfo_published_tx;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    seq2 = __atomic_load_n(&vfo_seq, __ATOMIC_RELAXED);
+
+    if (seq1 == seq2) { return seq1 / 2; }
+  }
+}
+
 const char* getModeName(int mode) {
   switch (mode) {
   case modeLSB:
@@ -153,7 +240,124 @@ static void vfo_save_bandstack(void) {
   }
 }
 
+//
+// Binary snapshot of mode_settings[]. Every member that is saved as a
+// text prop must be listed here.
+//
+#define MS struct _mode_settings
+static const SNAP_FIELD modeset_fields[] = {
+  SNAP_VAL(MS, filter),
+  SNAP_VAL(MS, cwPeak),
+  SNAP_VAL(MS, step),
+  SNAP_VAL(MS, rit_step),
+  SNAP_VAL(MS, nb),
+  SNAP_VAL(MS, nb_tau),
+  SNAP_VAL(MS, nb_hang),
+  SNAP_VAL(MS, nb_advtime),
+  SNAP_VAL(MS, nb_thresh),
+  SNAP_VAL(MS, nb2_mode),
+  SNAP_VAL(MS, nr),
+  SNAP_VAL(MS, nr_agc),
+  SNAP_VAL(MS, nr2_gain_method),
+  SNAP_VAL(MS, nr2_npe_method),
+  SNAP_VAL(MS, nr2_ae),
+  SNAP_VAL(MS, nr2_post),
+  SNAP_VAL(MS, nr2_post_taper),
+  SNAP_VAL(MS, nr2_post_nlevel),
+  SNAP_VAL(MS, nr2_post_factor),
+  SNAP_VAL(MS, nr2_post_rate),
+  SNAP_VAL(MS, nr2_trained_threshold),
+  SNAP_VAL(MS, nr2_trained_t2),
+  SNAP_VAL(MS, nr4_reduction_amount),
+  SNAP_VAL(MS, nr4_smoothing_factor),
+  SNAP_VAL(MS, nr4_whitening_factor),
+  SNAP_VAL(MS, nr4_noise_rescale),
+  SNAP_VAL(MS, nr4_post_filter_threshold),
+  SNAP_VAL(MS, anf),
+  SNAP_VAL(MS, snb),
+  SNAP_VAL(MS, agc),
+  SNAP_VAL(MS, en_rxeq),
+  SNAP_VAL(MS, en_txeq),
+  SNAP_VAL(MS, compressor),
+  SNAP_VAL(MS, compressor_level),
+  SNAP_VAL(MS, dexp),
+  SNAP_VAL(MS, dexp_trigger),
+  SNAP_VAL(MS, dexp_tau),
+  SNAP_VAL(MS, dexp_attack),
+  SNAP_VAL(MS, dexp_release),
+  SNAP_VAL(MS, dexp_hold),
+  SNAP_VAL(MS, dexp_exp),
+  SNAP_VAL(MS, dexp_hyst),
+  SNAP_VAL(MS, dexp_filter),
+  SNAP_VAL(MS, dexp_filter_low),
+  SNAP_VAL(MS, dexp_filter_high),
+  SNAP_VAL(MS, lev_enable),
+  SNAP_VAL(MS, lev_gain),
+  SNAP_VAL(MS, phrot_enable),
+#if defined (__CPYMODE__)
+  SNAP_VAL(MS, local_microphone),
+  SNAP_STR(MS, microphone_name),
+  SNAP_VAL(MS, puresignal),
+  SNAP_VAL(MS, use_rx_filter),
+#endif
+  SNAP_VAL(MS, cfc),
+  SNAP_VAL(MS, cfc_eq),
+  SNAP_ARR(MS, tx_eq_gain),
+  SNAP_ARR(MS, tx_eq_freq),
+  SNAP_ARR(MS, rx_eq_gain),
+  SNAP_ARR(MS, rx_eq_freq),
+  SNAP_ARR(MS, cfc_freq),
+  SNAP_ARR(MS, cfc_lvl),
+  SNAP_ARR(MS, cfc_post)
+};
+#undef MS
+
+static const SNAP_SECTION modeset_section = {
+  "modeset", modeset_fields, SNAP_NFIELDS(modeset_fields), (char *) mode_settings, sizeof(mode_settings[0]), MODES
+};
+
+static int modeset_sections(SNAP_SECTION *sec) {
+  *sec = modeset_section;
+  return 1;
+}
+
+//
+// Binary snapshot of vfo[], with the members saved as text props.
+// Before each checkpoint, the state of VFO A is stored in its
+// bandstack entry (as vfo_save_state does), so the "band" snapshot
+// has it as well.
+//
+static const SNAP_FIELD vfo_fields[] = {
+  SNAP_VAL(struct _vfo, band),
+  SNAP_VAL(struct _vfo, frequency),
+  SNAP_VAL(struct _vfo, ctun),
+  SNAP_VAL(struct _vfo, ctun_frequency),
+  SNAP_VAL(struct _vfo, rit),
+  SNAP_VAL(struct _vfo, rit_enabled),
+  SNAP_VAL(struct _vfo, xit),
+  SNAP_VAL(struct _vfo, xit_enabled),
+  SNAP_VAL(struct _vfo, lo),
+  SNAP_VAL(struct _vfo, offset),
+  SNAP_VAL(struct _vfo, mode),
+  SNAP_VAL(struct _vfo, filter),
+  SNAP_VAL(struct _vfo, cwAudioPeakFilter),
+  SNAP_VAL(struct _vfo, deviation),
+  SNAP_VAL(struct _vfo, step),
+  SNAP_VAL(struct _vfo, rit_step)
+};
+
+static const SNAP_SECTION vfo_section = {
+  "vfo", vfo_fields, SNAP_NFIELDS(vfo_fields), (char *) vfo, sizeof(vfo[0]), MAX_VFOS
+};
+
+static int vfo_sections(SNAP_SECTION *sec) {
+  *sec = vfo_section;
+  return 1;
+}
+
 static void modesettingsSaveState(void) {
+  if (!snapshot_save("modeset", &modeset_section, 1)) { return; }
+
   for (int i = 0; i < MODES; i++) {
     mode_settings[i].desc = getModeName(i); // save description of numeric mode number for better reading
     SetPropI1("modeset.%d.filter", i,                mode_settings[i].filter);
@@ -444,6 +648,11 @@ static void modesettingsRestoreState(void) {
     mode_settings[i].rx_eq_freq[12] =  8000.0;
     mode_settings[i].cfc_freq  [12] =  8000.0;
 #endif
+  }
+
+  if (!snapshot_restore("modeset", &modeset_section, 1)) { return; }
+
+  for (int i = 0; i < MODES; i++) {
     GetPropI1("modeset.%d.filter", i,                mode_settings[i].filter);
     GetPropI1("modeset.%d.cwPeak", i,                mode_settings[i].cwPeak);
     GetPropI1("modeset.%d.step", i,                  mode_settings[i].step);
@@ -566,25 +775,29 @@ void copy_mode_settings(int mode) {
 void vfo_save_state(void) {
   vfo_save_bandstack();
 
-  for (int i = 0; i < MAX_VFOS; i++) {
-    SetPropI1("vfo.%d.band", i,             vfo[i].band);
-    SetPropI1("vfo.%d.frequency", i,        vfo[i].frequency);
-    SetPropI1("vfo.%d.ctun", i,             vfo[i].ctun);
-    SetPropI1("vfo.%d.ctun_frequency", i,   vfo[i].ctun_frequency);
-    SetPropI1("vfo.%d.rit", i,              vfo[i].rit);
-    SetPropI1("vfo.%d.rit_enabled", i,      vfo[i].rit_enabled);
-    SetPropI1("vfo.%d.xit", i,              vfo[i].xit);
-    SetPropI1("vfo.%d.xit_enabled", i,      vfo[i].xit_enabled);
-    SetPropI1("vfo.%d.lo", i,               vfo[i].lo);
-    SetPropI1("vfo.%d.offset", i,           vfo[i].offset);
-    SetPropI1("vfo.%d.mode", i,             vfo[i].mode);
-    SetPropI1("vfo.%d.filter", i,           vfo[i].filter);
-    SetPropI1("vfo.%d.cw_apf", i,           vfo[i].cwAudioPeakFilter);
-    SetPropI1("vfo.%d.deviation", i,        vfo[i].deviation);
-    SetPropI1("vfo.%d.step", i,             vfo[i].step);
-    SetPropI1("vfo.%d.rit_step", i,         vfo[i].rit_step);
-  }
-
+  if (snapshot_save("vfo", &vfo_section, 1)) {
+    for (int i = 0; i < MAX_VFOS; i++) {
+      SetPropI1("vfo.%d.band", i,             vfo[i].band);
+      SetPropI1("vfo.%d.frequency", i,        vfo[i].frequency);
+      SetPropI1("vfo.%d.ctun", i,             vfo[i].ctun);
+      SetPropI1("vfo.%d.ctun_frequency", i,   vfo[i].ctun_frequency);
+      SetPropI1("vfo.%d.rit", i,              vfo[i].rit);
+      SetPropI1("vfo.%d.rit_enabled", i,      vfo[i].rit_enabled);
+      SetPropI1("vfo.%d.xit", i,              vfo[i].xit);
+      SetPropI1("vfo.%d.xit_enabled", i,      vfo[i].xit_enabled);
+      SetPropI1("vfo.%d.lo", i,               vfo[i].lo);
+      SetPropI1("vfo.%d.offset", i,           vfo[i].offset);
+      SetPropI1("vfo.%d.mode", i,             vfo[i].mode);
+      SetPropI1("vfo.%d.filter", i,           vfo[i].filter);
+      SetPropI1("vfo.%d.cw_apf", i,           vfo[i].cwAudioPeakFilter);
+      SetPropI1("vfo.%d.deviation", i,        vfo[i].deviation);
+      SetPropI1("vfo.%d.step", i,             vfo[i].step);
+      SetPropI1("vfo.%d.rit_step", i,         vfo[i].rit_step);
+    }
+  }
+
+  SetPropI0("vfo.fps",                      vfo_fps);
+  SetPropI0("vfo.accel",                    vfo_accel);
   modesettingsSaveState();
 }
 
@@ -621,30 +834,43 @@ void vfo_restore_state(void) {
     vfo[i].deviation         = 2500;
     vfo[i].step              = 100;
     vfo[i].rit_step          = 10;
-    GetPropI1("vfo.%d.band", i,             vfo[i].band);
-    GetPropI1("vfo.%d.frequency", i,        vfo[i].frequency);
-    GetPropI1("vfo.%d.ctun", i,             vfo[i].ctun);
-    GetPropI1("vfo.%d.ctun_frequency", i,   vfo[i].ctun_frequency);
-    GetPropI1("vfo.%d.rit", i,              vfo[i].rit);
-    GetPropI1("vfo.%d.rit_enabled", i,      vfo[i].rit_enabled);
-    GetPropI1("vfo.%d.xit", i,              vfo[i].xit);
-    GetPropI1("vfo.%d.xit_enabled", i,      vfo[i].xit_enabled);
-    GetPropI1("vfo.%d.lo", i,               vfo[i].lo);
-    GetPropI1("vfo.%d.offset", i,           vfo[i].offset);
-    GetPropI1("vfo.%d.mode", i,             vfo[i].mode);
-    GetPropI1("vfo.%d.filter", i,           vfo[i].filter);
-    GetPropI1("vfo.%d.cw_apf", i,           vfo[i].cwAudioPeakFilter);
-    GetPropI1("vfo.%d.deviation", i,        vfo[i].deviation);
-    GetPropI1("vfo.%d.step", i,             vfo[i].step);
-    GetPropI1("vfo.%d.rit_step", i,         vfo[i].rit_step);
+  }
 
+  if (snapshot_restore("vfo", &vfo_section, 1)) {
+    for (int i = 0; i < MAX_VFOS; i++) {
+      GetPropI1("vfo.%d.band", i,             vfo[i].band);
+      GetPropI1("vfo.%d.frequency", i,        vfo[i].frequency);
+      GetPropI1("vfo.%d.ctun", i,             vfo[i].ctun);
+      GetPropI1("vfo.%d.ctun_frequency", i,   vfo[i].ctun_frequency);
+      GetPropI1("vfo.%d.rit", i,              vfo[i].rit);
+      GetPropI1("vfo.%d.rit_enabled", i,      vfo[i].rit_enabled);
+      GetPropI1("vfo.%d.xit", i,              vfo[i].xit);
+      GetPropI1("vfo.%d.xit_enabled", i,      vfo[i].xit_enabled);
+      GetPropI1("vfo.%d.lo", i,               vfo[i].lo);
+      GetPropI1("vfo.%d.offset", i,           vfo[i].offset);
+      GetPropI1("vfo.%d.mode", i,             vfo[i].mode);
+      GetPropI1("vfo.%d.filter", i,           vfo[i].filter);
+      GetPropI1("vfo.%d.cw_apf", i,           vfo[i].cwAudioPeakFilter);
+      GetPropI1("vfo.%d.deviation", i,        vfo[i].deviation);
+      GetPropI1("vfo.%d.step", i,             vfo[i].step);
+      GetPropI1("vfo.%d.rit_step", i,         vfo[i].rit_step);
+    }
+  }
+
+  for (int i = 0; i < MAX_VFOS; i++) {
     // Sanity check: if !ctun, offset must be zero
     if (!vfo[i].ctun) {
       vfo[i].offset = 0;
     }
   }
 
+  GetPropI0("vfo.fps",                      vfo_fps);
+  GetPropI0("vfo.accel",                    vfo_accel);
   modesettingsRestoreState();
+  snapshot_register("modeset", modeset_sections);
+  snapshot_register("vfo", vfo_sections);
+  snapshot_add_prepare(vfo_save_bandstack);
+  vfo_publish();
 }
 
 static inline void vfo_adjust_band(int v, long long f) {
@@ -727,6 +953,10 @@ static inline void vfo_adjust_band(int v, long long f) {
 }
 
 void vfo_xvtr_changed(void) {
+  //
+  // XVTR bands (and their edges) may have changed
+  //
+  band_index_rebuild();
   //
   // It may happen that the XVTR band is messed up in the sense
   // that the resulting radio frequency exceeds the limits.
@@ -765,7 +995,7 @@ void vfo_xvtr_changed(void) {
 
   schedule_general();        // for disablePA
   schedule_high_priority();  // for Frequencies
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 #if defined (__CPYMODE__)
@@ -917,7 +1147,7 @@ void vfo_apply_mode_settings(RECEIVER *rx) {
   rx_set_agc(rx);
   update_noise();
   update_eq();
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 
   if (can_transmit && display_sliders) {
     if (n_input_devices > 0) {
@@ -1121,7 +1351,7 @@ void vfo_id_mode_changed(int id, int m) {
   //
   schedule_high_priority();       // update frequencies
   schedule_transmit_specific();   // update "CW" flag
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 void vfo_deviation_changed(int dev) {
@@ -1136,7 +1366,7 @@ void vfo_id_deviation_changed(int id, int dev) {
     rx_filter_changed(receiver[id]);
   }
 
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 void vfo_filter_changed(int f) {
@@ -1169,7 +1399,7 @@ void vfo_id_filter_changed(int id, int f) {
     }
   }
 
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 void vfo_vfos_changed(void) {
@@ -1190,7 +1420,7 @@ void vfo_vfos_changed(void) {
   // but if the mode changed to/from CW, we also need a DUCspecific packet
   //
   schedule_transmit_specific();
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 void vfo_a_to_b(void) {
@@ -1287,9 +1517,87 @@ void vfo_set_step_from_index(int id, int index) {
   }
 }
 
+//
+// Aggregation of tuning input.
+//
+// VFO encoders, MIDI wheels, the mouse wheel and panadapter dragging
+// produce many small steps in rapid succession, and each of them would
+// otherwise retune the receiver(s) and trigger a HighPrio packet and
+// a VFO bar update. Instead, vfo_step() and vfo_move() only add the
+// steps (or Hz) to per-VFO accumulators (lock-free, so they may be
+// called from any thread), and a "control tick" that runs every
+// VFO_TICK_MS applies the net change once through vfo_id_step() or
+// vfo_id_move(). The tick is only scheduled while there is input.
+//
+// With vfo_accel set, fast turning is accelerated: the net number
+// of steps per tick is multiplied by a factor that grows with the
+// turning speed.
+//
+// CAT and other callers that address a VFO explicitly still use
+// vfo_id_step() and vfo_id_move() directly, which act immediately.
+//
+#define VFO_TICK_MS 20
+
+static int vfo_pending_steps[MAX_VFOS];
+static long long vfo_pending_hz[MAX_VFOS];
+static int vfo_pending_round[MAX_VFOS];
+static int vfo_tick_scheduled = 0;
+
+static int vfo_accelerate(int steps) {
+  int n = abs(steps);
+
+  if (!vfo_accel || n < 3) {
+    return steps;
+  } else if (n < 6) {
+    return 2 * steps;
+  } else if (n < 10) {
+    return 4 * steps;
+  } else {
+    return 8 * steps;
+  }
+}
+
+static gboolean vfo_tick(gpointer data) {
+  //
+  // Clear the flag first: input arriving from now on schedules
+  // another tick (which may find nothing to do)
+  //
+  __atomic_store_n(&vfo_tick_scheduled, 0, __ATOMIC_RELEASE);
+
+  for (int id = 0; id < MAX_VFOS; id++) {
+    int steps = __atomic_exchange_n(&vfo_pending_steps[id], 0, __ATOMIC_ACQ_REL);
+    long long hz = __atomic_exchange_n(&vfo_pending_hz[id], 0, __ATOMIC_ACQ_REL);
+    int round = __atomic_exchange_n(&vfo_pending_round[id], 0, __ATOMIC_ACQ_REL);
+
+    if (steps != 0) {
+      P2TRACE_INSTANT("vfo tick steps", steps);
+      vfo_id_step(id, vfo_accelerate(steps));
+    }
+
+    if (hz != 0) {
+      P2TRACE_INSTANT("vfo tick move", (int) hz);
+      vfo_id_move(id, hz, round);
+    }
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void vfo_schedule_tick(void) {
+  int expected = 0;
+
+  if (__atomic_compare_exchange_n(&vfo_tick_scheduled, &expected, 1, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    g_timeout_add(VFO_TICK_MS, vfo_tick, NULL);
+  }
+}
+
 void vfo_step(int steps) {
   int id = active_receiver->id;
-  vfo_id_step(id, steps);
+
+  if (steps == 0) { return; }
+
+  __atomic_fetch_add(&vfo_pending_steps[id], steps, __ATOMIC_ACQ_REL);
+  vfo_schedule_tick();
 }
 
 void vfo_id_step(int id, int steps) {
@@ -1376,7 +1684,7 @@ void vfo_id_step(int id, int steps) {
       rx_frequency_changed(receiver[id]);
     }
 
-    g_idle_add(ext_vfo_update, NULL);
+    P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
   }
 }
 
@@ -1394,7 +1702,7 @@ void vfo_id_set_rit_step(int id, int step) {
     copy_mode_settings(mode);
   }
 
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 //
@@ -1506,12 +1814,20 @@ void vfo_id_move(int id, long long hz, int round) {
       rx_frequency_changed(receiver[id]);
     }
 
-    g_idle_add(ext_vfo_update, NULL);
+    P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
   }
 }
 
 void vfo_move(long long hz, int round) {
-  vfo_id_move(active_receiver->id, hz, round);
+  int id = active_receiver->id;
+
+  if (hz == 0) { return; }
+
+  __atomic_fetch_add(&vfo_pending_hz[id], hz, __ATOMIC_ACQ_REL);
+
+  if (round) { __atomic_store_n(&vfo_pending_round[id], 1, __ATOMIC_RELEASE); }
+
+  vfo_schedule_tick();
 }
 
 void vfo_move_to(long long hz) {
@@ -1615,7 +1931,7 @@ void vfo_id_move_to(int id, long long hz) {
       rx_vfo_changed(receiver[id]);
     }
 
-    g_idle_add(ext_vfo_update, NULL);
+    P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
   }
 }
 
@@ -1632,46 +1948,713 @@ static gboolean vfo_scroll_event_cb (GtkWidget *widget, GdkEventScroll *event, g
   return rx_scroll_event(widget, event, rx);
 }
 
+//
+// The VFO bar consists of elements (the mode string, the two dials, and
+// all the status indicators). Each element is a sequence of text runs
+// with individual font size and colour, drawn starting at (x,y).
+//
+// vfo_update() first determines, for each element, what *should* be
+// displayed. This description is then compared with what has been drawn
+// the last time, and only the elements that have changed are re-drawn:
+// the area they covered before and the area they cover now is cleared,
+// and all elements which overlap with this "damage region" are drawn
+// (clipped to the damage region). Only the damage region is then
+// passed to GTK for re-drawing the panel.
+//
+// The colours are part of the element description, so a change of the
+// colour scheme is picked up automatically.
+//
+#define VFO_MAX_RUNS 4
+
+typedef struct _vfo_run {
+  double size;
+  double rgba[4];
+  char   text[32];
+} VFO_RUN;
+
+typedef struct _vfo_element {
+  int     x, y;
+  int     nrun;                 // zero if the element is not shown
+  VFO_RUN run[VFO_MAX_RUNS];
+} VFO_ELEMENT;
+
+enum {
+  VFO_E_MODE = 0,
+  VFO_E_VFO_A,
+  VFO_E_VFO_B,
+  VFO_E_ZOOM,
+  VFO_E_PS,
+  VFO_E_RIT,
+  VFO_E_XIT,
+  VFO_E_NB,
+  VFO_E_NR,
+  VFO_E_ANF,
+  VFO_E_SNB,
+  VFO_E_DEXP,
+  VFO_E_AGC,
+  VFO_E_CMPR,
+  VFO_E_RXEQ,
+  VFO_E_PROC,
+  VFO_E_STEP,
+  VFO_E_CTUN,
+  VFO_E_CAT,
+  VFO_E_MUTE,
+  VFO_E_TXEQ,
+  VFO_E_LEV,
+  VFO_E_PHROT,
+  VFO_E_AG,
+  VFO_E_CL1,
+  VFO_E_NFA,
+  VFO_E_TUNED,
+  VFO_E_PREAMP,
+  VFO_E_VOX,
+  VFO_E_LOCK,
+  VFO_E_MGAIN,
+  VFO_E_ATU,
+  VFO_E_PA,
+  VFO_E_SPLIT,
+  VFO_E_SAT,
+  VFO_E_DUP,
+  VFO_E_CESSB,
+  VFO_E_MULTIFN,
+  VFO_NUM_ELEMENTS
+};
+
+static VFO_ELEMENT vfo_elem_drawn[VFO_NUM_ELEMENTS];     // what is in the back buffer (render thread)
+static VFO_ELEMENT vfo_elem_next[VFO_NUM_ELEMENTS];      // what should be there (main thread)
+static cairo_rectangle_int_t vfo_elem_area[VFO_NUM_ELEMENTS];
+static double vfo_backgnd[4];
+static int vfo_drawn_layout = -1;
+
+static VFO_ELEMENT *vfo_elem_start(int e, int x, int y) {
+  VFO_ELEMENT *el = &vfo_elem_next[e];
+  memset(el, 0, sizeof(VFO_ELEMENT));
+  el->x = x;
+  el->y = y;
+  return el;
+}
+
+static void vfo_elem_add(VFO_ELEMENT *el, double size, const double *rgba, const char *text) {
+  if (el->nrun >= VFO_MAX_RUNS) { return; }
+
+  VFO_RUN *run = &el->run[el->nrun++];
+  run->size = size;
+  memcpy(run->rgba, rgba, sizeof(run->rgba));
+  snprintf(run->text, sizeof(run->text), "%s", text);
+}
+
+//
+// Most elements consist of a single run
+//
+static void vfo_elem_text(int e, int x, int y, double size, const double *rgba, const char *text) {
+  vfo_elem_add(vfo_elem_start(e, x, y), size, rgba, text);
+}
+
+//
+// Glyph atlas for the VFO dials.
+//
+// The digits, the decimal point, and the fixed labels of the dials are
+// rendered once per font size into an alpha-only image surface. Drawing
+// a frequency then is a sequence of cairo_mask_surface() calls with
+// sub-surfaces of this atlas, using the current source colour, instead
+// of laying out text with cairo_show_text().
+//
+// The atlases are discarded when the VFO bar layout (and thus the font
+// sizes) or the colour scheme changes.
+//
+#define VFO_ATLAS_GLYPHS 14
+#define VFO_ATLAS_DIGITS 11         // the first glyphs are single characters
+#define VFO_NUM_ATLAS     4
+
+static const char *vfo_atlas_text[VFO_ATLAS_GLYPHS] = {
+  "0", "1", "2", "3", "4", "5", "6", "7", "8", "9", ".",
+  "A:", "B:", "Out of band"
+};
+
+typedef struct _vfo_glyph {
+  cairo_surface_t *mask;    // sub-surface of the atlas
+  int              dx, dy;  // position of the mask relative to the pen position
+  double           advance;
+  double           x1, y1, x2, y2;  // ink extents relative to the pen position
+} VFO_GLYPH;
+
+typedef struct _vfo_atlas {
+  double           size;    // font size, zero if unused
+  double           ascent, descent;
+  cairo_surface_t *surface;
+  VFO_GLYPH        glyph[VFO_ATLAS_GLYPHS];
+} VFO_ATLAS;
+
+static VFO_ATLAS vfo_atlas[VFO_NUM_ATLAS];
+
+static void vfo_atlas_clear(void) {
+  for (int a = 0; a < VFO_NUM_ATLAS; a++) {
+    VFO_ATLAS *atlas = &vfo_atlas[a];
+
+    if (atlas->size == 0.0) { continue; }
+
+    for (int g = 0; g < VFO_ATLAS_GLYPHS; g++) {
+      cairo_surface_destroy(atlas->glyph[g].mask);
+    }
+
+    cairo_surface_destroy(atlas->surface);
+    memset(atlas, 0, sizeof(VFO_ATLAS));
+  }
+}
+
+static VFO_ATLAS *vfo_atlas_get(cairo_t *cr, double size) {
+  VFO_ATLAS *atlas = NULL;
+  cairo_font_extents_t fe;
+  cairo_text_extents_t te[VFO_ATLAS_GLYPHS];
+  double top;
+  int width = 0;
+  int height;
+  int base;
+
+  for (int a = 0; a < VFO_NUM_ATLAS; a++) {
+    if (vfo_atlas[a].size == size) { return &vfo_atlas[a]; }
+
+    if (atlas == NULL && vfo_atlas[a].size == 0.0) { atlas = &vfo_atlas[a]; }
+  }
+
+  if (atlas == NULL) {
+    // all slots in use (should not happen with two font sizes per layout)
+    vfo_atlas_clear();
+    atlas = &vfo_atlas[0];
+  }
+
+  //
+  // Measure all glyphs with the font selected in cr. Each glyph gets
+  // a cell of the full font height, with one pixel of padding around
+  // its ink extents.
+  //
+  cairo_set_font_size(cr, size);
+  cairo_font_extents(cr, &fe);
+  top = fe.ascent;
+
+  for (int g = 0; g < VFO_ATLAS_GLYPHS; g++) {
+    cairo_text_extents(cr, vfo_atlas_text[g], &te[g]);
+    width += (int) ceil(te[g].width) + 4;
+    top = fmax(top, -te[g].y_bearing);
+  }
+
+  base = (int) ceil(top) + 2;
+  height = base + (int) ceil(fe.descent) + 2;
+  atlas->size = size;
+  atlas->ascent = fe.ascent;
+  atlas->descent = fe.descent;
+  atlas->surface = cairo_image_surface_create(CAIRO_FORMAT_A8, width, height);
+  cairo_t *acr = cairo_create(atlas->surface);
+  cairo_set_font_face(acr, cairo_get_font_face(cr));
+  cairo_set_font_size(acr, size);
+  cairo_set_source_rgba(acr, 0.0, 0.0, 0.0, 1.0);
+  int x = 0;
+
+  for (int g = 0; g < VFO_ATLAS_GLYPHS; g++) {
+    VFO_GLYPH *glyph = &atlas->glyph[g];
+    int w = (int) ceil(te[g].width) + 4;
+    int left = (int) floor(te[g].x_bearing) - 1;     // left edge of cell relative to pen
+    cairo_move_to(acr, x - left, base);
+    cairo_show_text(acr, vfo_atlas_text[g]);
+    glyph->mask = cairo_surface_create_for_rectangle(atlas->surface, x, 0, w, height);
+    glyph->dx = left;
+    glyph->dy = -base;
+    glyph->advance = te[g].x_advance;
+    glyph->x1 = te[g].x_bearing;
+    glyph->y1 = te[g].y_bearing;
+    glyph->x2 = te[g].x_bearing + te[g].width;
+    glyph->y2 = te[g].y_bearing + te[g].height;
+    x += w;
+  }
+
+  cairo_destroy(acr);
+  return atlas;
+}
+
+//
+// Split a text into atlas glyphs. Returns the number of glyphs,
+// or -1 if the text cannot be drawn from the atlas.
+//
+static int vfo_atlas_parse(const char *text, int *glyphs, int max) {
+  int n = 0;
+
+  for (int g = VFO_ATLAS_DIGITS; g < VFO_ATLAS_GLYPHS; g++) {
+    if (!strcmp(text, vfo_atlas_text[g])) {
+      glyphs[0] = g;
+      return 1;
+    }
+  }
+
+  for (const char *cp = text; *cp; cp++) {
+    if (n >= max) { return -1; }
+
+    if (*cp >= '0' && *cp <= '9') {
+      glyphs[n++] = *cp - '0';
+    } else if (*cp == '.') {
+      glyphs[n++] = 10;
+    } else {
+      return -1;
+    }
+  }
+
+  return n;
+}
+
+//
+// Draw a text from the atlas at the current point, using the current
+// source, and advance the current point. Returns FALSE if the text
+// contains anything not in the atlas.
+//
+static int vfo_atlas_show(cairo_t *cr, double size, const char *text) {
+  int glyphs[32];
+  int n = vfo_atlas_parse(text, glyphs, 32);
+  double x, y;
+
+  if (n < 0) { return FALSE; }
+
+  const VFO_ATLAS *atlas = vfo_atlas_get(cr, size);
+  cairo_get_current_point(cr, &x, &y);
+
+  for (int i = 0; i < n; i++) {
+    const VFO_GLYPH *glyph = &atlas->glyph[glyphs[i]];
+    cairo_mask_surface(cr, glyph->mask, round(x) + glyph->dx, round(y) + glyph->dy);
+    x += glyph->advance;
+  }
+
+  cairo_move_to(cr, x, y);
+  return TRUE;
+}
+
+//
+// Text and font extents from the atlas. Returns FALSE if the text
+// contains anything not in the atlas.
+//
+static int vfo_atlas_extents(cairo_t *cr, double size, const char *text,
+                             cairo_text_extents_t *te, cairo_font_extents_t *fe) {
+  int glyphs[32];
+  int n = vfo_atlas_parse(text, glyphs, 32);
+  double x = 0.0;
+  double x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0;
+
+  if (n < 0) { return FALSE; }
+
+  const VFO_ATLAS *atlas = vfo_atlas_get(cr, size);
+
+  for (int i = 0; i < n; i++) {
+    const VFO_GLYPH *glyph = &atlas->glyph[glyphs[i]];
+
+    if (i == 0) {
+      x1 = glyph->x1;
+      y1 = glyph->y1;
+      x2 = glyph->x2;
+      y2 = glyph->y2;
+    } else {
+      x1 = fmin(x1, x + glyph->x1);
+      y1 = fmin(y1, glyph->y1);
+      x2 = fmax(x2, x + glyph->x2);
+      y2 = fmax(y2, glyph->y2);
+    }
+
+    x += glyph->advance;
+  }
+
+  te->x_bearing = x1;
+  te->y_bearing = y1;
+  te->width = x2 - x1;
+  te->height = y2 - y1;
+  te->x_advance = x;
+  te->y_advance = 0.0;
+  fe->ascent = atlas->ascent;
+  fe->descent = atlas->descent;
+  return TRUE;
+}
+
+//
+// Surface area covered by an element: the union of the "logical"
+// (advance x font height) and the "ink" rectangles of all runs
+//
+static void vfo_elem_get_area(cairo_t *cr, const VFO_ELEMENT *el, cairo_rectangle_int_t *area) {
+  double x = el->x;
+  double x1 = el->x, y1 = el->y, x2 = el->x, y2 = el->y;
+
+  for (int i = 0; i < el->nrun; i++) {
+    cairo_font_extents_t fe;
+    cairo_text_extents_t te;
+
+    if (!vfo_atlas_extents(cr, el->run[i].size, el->run[i].text, &te, &fe)) {
+      cairo_set_font_size(cr, el->run[i].size);
+      cairo_font_extents(cr, &fe);
+      cairo_text_extents(cr, el->run[i].text, &te);
+    }
+
+    x1 = fmin(x1, fmin(x, x + te.x_bearing));
+    x2 = fmax(x2, fmax(x + te.x_advance, x + te.x_bearing + te.width));
+    y1 = fmin(y1, fmin(el->y - fe.ascent, el->y + te.y_bearing));
+    y2 = fmax(y2, fmax(el->y + fe.descent, el->y + te.y_bearing + te.height));
+    x += te.x_advance;
+  }
+
+  area->x = (int) floor(x1) - 1;
+  area->y = (int) floor(y1) - 1;
+  area->width = (int) ceil(x2) - area->x + 2;
+  area->height = (int) ceil(y2) - area->y + 2;
+}
+
+static void vfo_elem_draw(cairo_t *cr, const VFO_ELEMENT *el) {
+  cairo_move_to(cr, el->x, el->y);
+
+  for (int i = 0; i < el->nrun; i++) {
+    const VFO_RUN *run = &el->run[i];
+    cairo_set_source_rgba(cr, run->rgba[0], run->rgba[1], run->rgba[2], run->rgba[3]);
+
+    if (!vfo_atlas_show(cr, run->size, run->text)) {
+      cairo_set_font_size(cr, run->size);
+      cairo_show_text(cr, run->text);
+    }
+  }
+}
+
+//
+// The VFO bar is drawn by a separate render thread into two image
+// surfaces (double buffering). The main thread only takes a snapshot
+// of what should be displayed (vfo_render() fills vfo_elem_next and
+// hands it over as a VFO_JOB), and paints the front buffer in
+// vfo_draw_cb(). So a lengthy re-draw never delays the GTK main loop.
+//
+// The render thread always works on the latest job: if several jobs
+// are submitted while it is busy, only the last one is drawn.
+//
+typedef struct _vfo_job {
+  VFO_ELEMENT elem[VFO_NUM_ELEMENTS];
+  double      backgnd[4];
+  int         layout;
+  int         width, height;
+  int         damage_all;
+} VFO_JOB;
+
+static VFO_JOB vfo_job;                        // protected by vfo_job_mutex
+static int vfo_job_pending = 0;
+static GMutex vfo_job_mutex;
+static GCond vfo_job_cond;
+static GThread *vfo_render_thread_id = NULL;
+
+static cairo_surface_t *vfo_buffer[2] = { NULL, NULL };
+static int vfo_front = 0;                      // vfo_buffer[vfo_front] is displayed
+static GMutex vfo_buffer_mutex;                // protects vfo_front and (re-)allocation
+static int vfo_buffer_width = 0;               // render thread only
+static int vfo_buffer_height = 0;
+static cairo_region_t *vfo_last_damage = NULL; // render thread only
+
+//
+// Compare the job with vfo_elem_drawn, re-draw the damaged part of the
+// (back buffer) surface, and return the damaged region
+//
+static cairo_region_t *vfo_elem_render(cairo_t *cr, const VFO_JOB *job) {
+  cairo_region_t *damage = cairo_region_create();
+  int damage_all = job->damage_all;
+
+  if (memcmp(job->backgnd, vfo_backgnd, sizeof(vfo_backgnd)) || job->layout != vfo_drawn_layout) {
+    memcpy(vfo_backgnd, job->backgnd, sizeof(vfo_backgnd));
+    vfo_drawn_layout = job->layout;
+    vfo_atlas_clear();
+    damage_all = 1;
+  }
+
+  if (damage_all) {
+    cairo_rectangle_int_t all = { 0, 0, job->width, job->height };
+    cairo_region_union_rectangle(damage, &all);
+  }
+
+  for (int e = 0; e < VFO_NUM_ELEMENTS; e++) {
+    if (!damage_all && !memcmp(&job->elem[e], &vfo_elem_drawn[e], sizeof(VFO_ELEMENT))) { continue; }
+
+    if (vfo_elem_drawn[e].nrun > 0) { cairo_region_union_rectangle(damage, &vfo_elem_area[e]); }
+
+    memcpy(&vfo_elem_drawn[e], &job->elem[e], sizeof(VFO_ELEMENT));
+
+    if (vfo_elem_drawn[e].nrun > 0) {
+      vfo_elem_get_area(cr, &vfo_elem_drawn[e], &vfo_elem_area[e]);
+      cairo_region_union_rectangle(damage, &vfo_elem_area[e]);
+    }
+  }
+
+  if (!cairo_region_is_empty(damage)) {
+    int n = cairo_region_num_rectangles(damage);
+    cairo_save(cr);
+
+    for (int i = 0; i < n; i++) {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle(damage, i, &rect);
+      cairo_rectangle(cr, rect.x, rect.y, rect.width, rect.height);
+    }
+
+    cairo_clip(cr);
+    cairo_set_source_rgba(cr, vfo_backgnd[0], vfo_backgnd[1], vfo_backgnd[2], vfo_backgnd[3]);
+    cairo_paint(cr);
+
+    //
+    // Elements that overlap with the damage region have been partially
+    // erased and must be re-drawn, even if they did not change
+    //
+    for (int e = 0; e < VFO_NUM_ELEMENTS; e++) {
+      if (vfo_elem_drawn[e].nrun > 0
+          && cairo_region_contains_rectangle(damage, &vfo_elem_area[e]) != CAIRO_REGION_OVERLAP_OUT) {
+        vfo_elem_draw(cr, &vfo_elem_drawn[e]);
+      }
+    }
+
+    cairo_restore(cr);
+  }
+
+  return damage;
+}
+
+//
+// Main thread: queue the damaged areas of the panel for drawing
+//
+static gboolean vfo_queue_damage(gpointer data) {
+  cairo_region_t *damage = (cairo_region_t *) data;
+  int n = cairo_region_num_rectangles(damage);
+
+  for (int i = 0; i < n; i++) {
+    cairo_rectangle_int_t rect;
+    cairo_region_get_rectangle(damage, i, &rect);
+    gtk_widget_queue_draw_area(vfo_panel, rect.x, rect.y, rect.width, rect.height);
+  }
+
+  cairo_region_destroy(damage);
+  return G_SOURCE_REMOVE;
+}
+
+//
+// Draw one frame into the back buffer and make it the front buffer
+//
+static void vfo_render_frame(VFO_JOB *job) {
+  cairo_t *cr;
+
+  if (job->width != vfo_buffer_width || job->height != vfo_buffer_height) {
+    //
+    // (Re-)allocate both buffers, initialised to the background colour
+    //
+    g_mutex_lock(&vfo_buffer_mutex);
+
+    for (int i = 0; i < 2; i++) {
+      if (vfo_buffer[i]) { cairo_surface_destroy(vfo_buffer[i]); }
+
+      vfo_buffer[i] = cairo_image_surface_create(CAIRO_FORMAT_RGB24, job->width, job->height);
+      cr = cairo_create(vfo_buffer[i]);
+      cairo_set_source_rgba(cr, job->backgnd[0], job->backgnd[1], job->backgnd[2], job->backgnd[3]);
+      cairo_paint(cr);
+      cairo_destroy(cr);
+    }
+
+    g_mutex_unlock(&vfo_buffer_mutex);
+    vfo_buffer_width = job->width;
+    vfo_buffer_height = job->height;
+    job->damage_all = 1;
+
+    if (vfo_last_damage) {
+      cairo_region_destroy(vfo_last_damage);
+      vfo_last_damage = NULL;
+    }
+  }
+
+  P2TRACE_BEGIN("vfo render frame");
+  cairo_surface_t *front = vfo_buffer[vfo_front];
+  cairo_surface_t *back = vfo_buffer[1 - vfo_front];
+  cr = cairo_create(back);
+
+  //
+  // The back buffer lacks what has been drawn into the front buffer
+  // in the previous frame. Only the main thread reads the front buffer
+  // concurrently, and it never writes to it.
+  //
+  if (vfo_last_damage && !cairo_region_is_empty(vfo_last_damage)) {
+    int n = cairo_region_num_rectangles(vfo_last_damage);
+    cairo_save(cr);
+
+    for (int i = 0; i < n; i++) {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle(vfo_last_damage, i, &rect);
+      cairo_rectangle(cr, rect.x, rect.y, rect.width, rect.height);
+    }
+
+    cairo_clip(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface(cr, front, 0.0, 0.0);
+    cairo_paint(cr);
+    cairo_restore(cr);
+  }
+
+  cairo_select_font_face(cr, DISPLAY_FONT_BOLD, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+  cairo_region_t *damage = vfo_elem_render(cr, job);
+  cairo_destroy(cr);
+  cairo_surface_flush(back);
+  g_mutex_lock(&vfo_buffer_mutex);
+  vfo_front = 1 - vfo_front;
+  g_mutex_unlock(&vfo_buffer_mutex);
+
+  if (vfo_last_damage) { cairo_region_destroy(vfo_last_damage); }
+
+  vfo_last_damage = cairo_region_copy(damage);
+
+  //
+  // vfo_panel is NULL when rendering off-screen (p2bench)
+  //
+  if (vfo_panel && !cairo_region_is_empty(damage)) {
+    g_idle_add(vfo_queue_damage, damage);
+  } else {
+    cairo_region_destroy(damage);
+  }
+
+  P2TRACE_END("vfo render frame");
+}
+
+static gpointer vfo_render_thread(gpointer data) {
+  VFO_JOB *job = g_new(VFO_JOB, 1);
+
+  for (;;) {
+    g_mutex_lock(&vfo_job_mutex);
+
+    while (!vfo_job_pending) {
+      g_cond_wait(&vfo_job_cond, &vfo_job_mutex);
+    }
+
+    memcpy(job, &vfo_job, sizeof(VFO_JOB));
+    //
+    // The job has been taken over, including its damage. Per-element
+    // damage is derived from vfo_elem_drawn, so only the "whole bar"
+    // flag has to be reset here.
+    //
+    vfo_job.damage_all = 0;
+    vfo_job_pending = 0;
+    g_mutex_unlock(&vfo_job_mutex);
+    vfo_render_frame(job);
+  }
+
+  return NULL;
+}
+
+//
+// Main thread: hand over vfo_elem_next to the render thread.
+// If there is no render thread (p2bench), draw synchronously.
+//
+static void vfo_render_submit(void) {
+  g_mutex_lock(&vfo_job_mutex);
+  memcpy(vfo_job.elem, vfo_elem_next, sizeof(vfo_elem_next));
+  double bg[4] = { COLOUR_VFO_BACKGND };
+  memcpy(vfo_job.backgnd, bg, sizeof(bg));
+  vfo_job.layout = vfo_layout;
+  vfo_job.width = vfo_surface_width;
+  vfo_job.height = vfo_surface_height;
+  vfo_job.damage_all |= vfo_damage_all;
+  vfo_damage_all = 0;
+
+  if (vfo_render_thread_id == NULL) {
+    vfo_render_frame(&vfo_job);
+    vfo_job.damage_all = 0;
+    g_mutex_unlock(&vfo_job_mutex);
+    return;
+  }
+
+  vfo_job_pending = 1;
+  g_cond_signal(&vfo_job_cond);
+  g_mutex_unlock(&vfo_job_mutex);
+}
+
 static gboolean vfo_configure_event_cb (GtkWidget         *widget,
                                         GdkEventConfigure *event,
                                         gpointer           data) {
-  if (vfo_surface) {
-    cairo_surface_destroy (vfo_surface);
+  //
+  // The buffers are (re-)allocated by the render thread
+  // when the next frame is drawn
+  //
+  vfo_surface_width = gtk_widget_get_allocated_width (widget);
+  vfo_surface_height = gtk_widget_get_allocated_height (widget);
+  vfo_damage_all = 1;
+
+  if (vfo_render_thread_id == NULL) {
+    vfo_render_thread_id = g_thread_new("VFO render", vfo_render_thread, NULL);
   }
 
-  vfo_surface = gdk_window_create_similar_surface (gtk_widget_get_window (widget),
-                CAIRO_CONTENT_COLOR,
-                gtk_widget_get_allocated_width (widget),
-                gtk_widget_get_allocated_height (widget));
-  /* Initialize the surface to black */
-  cairo_t *cr;
-  cr = cairo_create (vfo_surface);
-  cairo_set_source_rgba(cr, COLOUR_VFO_BACKGND);
-  cairo_paint (cr);
-  cairo_destroy(cr);
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
   return TRUE;
 }
 
 static gboolean vfo_draw_cb (GtkWidget *widget,
                              cairo_t   *cr,
                              gpointer   data) {
-  cairo_set_source_surface (cr, vfo_surface, 0.0, 0.0);
-  cairo_paint (cr);
+  g_mutex_lock(&vfo_buffer_mutex);
+
+  if (vfo_buffer[vfo_front]) {
+    cairo_set_source_surface (cr, vfo_buffer[vfo_front], 0.0, 0.0);
+    cairo_paint (cr);
+  } else {
+    cairo_set_source_rgba(cr, COLOUR_VFO_BACKGND);
+    cairo_paint (cr);
+  }
+
+  g_mutex_unlock(&vfo_buffer_mutex);
   return FALSE;
 }
 
 //
-// This function re-draws the VFO bar.
+// Set up the element for a VFO dial
+//
+static void vfo_elem_dial(int e, const VFO_BAR_LAYOUT *vfl, int x, int y, const char *label,
+                          const double *rgba, long long freq, int oob, const char *entered) {
+  char temp_text[32];
+  const double backgnd[4] = { COLOUR_VFO_BACKGND };
+  VFO_ELEMENT *el = vfo_elem_start(e, x, y);
+  int f_m = freq / 1000000LL;                          // MHz part
+  int f_k = (freq - 1000000LL * f_m) / 1000;           // kHz part
+  int f_h = (freq - 1000000LL * f_m - 1000 * f_k);     // Hz  part
+  vfo_elem_add(el, vfl->size2, rgba, label);
+
+  if (oob) {
+    vfo_elem_add(el, vfl->size3, rgba, "Out of band");
+  } else if (entered[0]) {
+    vfo_elem_add(el, vfl->size3, rgba, entered);
+  } else {
+    //
+    // poor man's right alignment:
+    // If the frequency is small, print some zeroes
+    // with the background colour
+    //
+    const char *pad = "";
+
+    if (f_m < 10) {
+      pad = "0000";
+    } else if (f_m < 100) {
+      pad = "000";
+    } else if (f_m < 1000) {
+      pad = "00";
+    } else if (f_m < 10000) {
+      pad = "0";
+    }
+
+    vfo_elem_add(el, vfl->size3, backgnd, pad);
+    snprintf(temp_text, 32, "%0d.%03d", f_m, f_k);
+    vfo_elem_add(el, vfl->size3, rgba, temp_text);
+    snprintf(temp_text, 32, "%03d", f_h);
+    vfo_elem_add(el, vfl->size2, rgba, temp_text);
+  }
+}
+
+//
+// This function re-draws the VFO bar: it determines what is to be
+// displayed and hands this over to the render thread.
 // Lot of elements are programmed, whose size and position
 // is determined by the current vfo_layout
 // Elements whose x-coordinate is zero are not drawn
 //
-void vfo_update(void) {
+static void vfo_render(void) {
   char wid[6];
 
-  if (!vfo_surface) { return; }
+  if (vfo_surface_width == 0) { return; }
 
+  P2TRACE_BEGIN("vfo_render");
+  vfo_last_render = g_get_monotonic_time();
   int id = active_receiver->id;
   int m = vfo[id].mode;
   //
@@ -1715,11 +2698,13 @@ void vfo_update(void) {
   FILTER* band_filters = filters[m];
   const FILTER* band_filter = &band_filters[f];
   char temp_text[32];
-  cairo_t *cr;
-  cr = cairo_create (vfo_surface);
-  cairo_set_source_rgba(cr, COLOUR_VFO_BACKGND);
-  cairo_paint (cr);
-  cairo_select_font_face(cr, DISPLAY_FONT_BOLD, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+  const double col_ok[4] = { COLOUR_OK };
+  const double col_weak[4] = { COLOUR_OK_WEAK };
+  const double col_attn[4] = { COLOUR_ATTN };
+  const double col_shade[4] = { COLOUR_SHADE };
+  const double col_alarm[4] = { COLOUR_ALARM };
+  const double *col;
+  memset(vfo_elem_next, 0, sizeof(vfo_elem_next));
 
   // -----------------------------------------------------------
   //
@@ -1794,10 +2779,7 @@ void vfo_update(void) {
       break;
     }
 
-    cairo_set_font_size(cr, vfl->size1 + 2);
-    cairo_set_source_rgba(cr, COLOUR_ATTN);
-    cairo_move_to(cr, vfl->mode_x, vfl->mode_y);
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_MODE, vfl->mode_x, vfl->mode_y, vfl->size1 + 2, col_attn, temp_text);
   }
 
   // In what follows, we want to display the VFO frequency
@@ -1840,9 +2822,6 @@ void vfo_update(void) {
 
 #endif
   int oob = 0;
-  int f_m; // MHz part
-  int f_k; // kHz part
-  int f_h; // Hz  part
 
   if (can_transmit) { oob = transmitter->out_of_band; }
 
@@ -1852,56 +2831,18 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->vfo_a_x != 0) {
-    cairo_move_to(cr, abs(vfl->vfo_a_x), vfl->vfo_a_y);
-
     if (txvfo == 0 && (radio_is_transmitting() || oob)) {
-      cairo_set_source_rgba(cr, COLOUR_ALARM);
+      col = col_alarm;
     } else if (vfo[0].entered_frequency[0]) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
+      col = col_attn;
     } else if (id != 0) {
-      cairo_set_source_rgba(cr, COLOUR_OK_WEAK);
+      col = col_weak;
     } else {
-      cairo_set_source_rgba(cr, COLOUR_OK);
+      col = col_ok;
     }
 
-    f_m = af / 1000000LL;
-    f_k = (af - 1000000LL * f_m) / 1000;
-    f_h = (af - 1000000LL * f_m - 1000 * f_k);
-    cairo_set_font_size(cr, vfl->size2);
-    cairo_show_text(cr, "A:");
-    cairo_set_font_size(cr, vfl->size3);
-
-    if (txvfo == 0 && oob) {
-      cairo_show_text(cr, "Out of band");
-    } else if (vfo[0].entered_frequency[0]) {
-      snprintf(temp_text, sizeof(temp_text), "%s", vfo[0].entered_frequency);
-      cairo_show_text(cr, temp_text);
-    } else {
-      //
-      // poor man's right alignment:
-      // If the frequency is small, print some zeroes
-      // with the background colour
-      //
-      cairo_save(cr);
-      cairo_set_source_rgba(cr, COLOUR_VFO_BACKGND);
-
-      if (f_m < 10) {
-        cairo_show_text(cr, "0000");
-      } else if (f_m < 100) {
-        cairo_show_text(cr, "000");
-      } else if (f_m < 1000) {
-        cairo_show_text(cr, "00");
-      } else if (f_m < 10000) {
-        cairo_show_text(cr, "0");
-      }
-
-      cairo_restore(cr);
-      snprintf(temp_text, 32, "%0d.%03d", f_m, f_k);
-      cairo_show_text(cr, temp_text);
-      cairo_set_font_size(cr, vfl->size2);
-      snprintf(temp_text, 32, "%03d", f_h);
-      cairo_show_text(cr, temp_text);
-    }
+    vfo_elem_dial(VFO_E_VFO_A, vfl, abs(vfl->vfo_a_x), vfl->vfo_a_y, "A:", col, af,
+                  txvfo == 0 && oob, vfo[0].entered_frequency);
   }
 
   // -----------------------------------------------------------
@@ -1910,63 +2851,25 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->vfo_b_x != 0) {
-    cairo_move_to(cr, abs(vfl->vfo_b_x), abs(vfl->vfo_b_y));
-
     if (txvfo == 1 && (radio_is_transmitting() || oob)) {
-      cairo_set_source_rgba(cr, COLOUR_ALARM);
+      col = col_alarm;
     } else if (vfo[1].entered_frequency[0]) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
+      col = col_attn;
     } else if (id != 1) {
-      cairo_set_source_rgba(cr, COLOUR_OK_WEAK);
+      col = col_weak;
     } else {
-      cairo_set_source_rgba(cr, COLOUR_OK);
+      col = col_ok;
     }
 
-    f_m = bf / 1000000LL;
-    f_k = (bf - 1000000LL * f_m) / 1000;
-    f_h = (bf - 1000000LL * f_m - 1000 * f_k);
-    cairo_set_font_size(cr, vfl->size2);
-    cairo_show_text(cr, "B:");
-    cairo_set_font_size(cr, vfl->size3);
-
-    if (txvfo == 0 && oob) {
-      cairo_show_text(cr, "Out of band");
-    } else if (vfo[1].entered_frequency[0]) {
-      snprintf(temp_text, sizeof(temp_text), "%s", vfo[1].entered_frequency);
-      cairo_show_text(cr, temp_text);
-    } else {
-      //
-      // poor man's right alignment:
-      // If the frequency is small, print some zeroes
-      // with the background colour
-      //
-      cairo_save(cr);
-      cairo_set_source_rgba(cr, COLOUR_VFO_BACKGND);
-
-      if (f_m < 10) {
-        cairo_show_text(cr, "0000");
-      } else if (f_m < 100) {
-        cairo_show_text(cr, "000");
-      } else if (f_m < 1000) {
-        cairo_show_text(cr, "00");
-      } else if (f_m < 10000) {
-        cairo_show_text(cr, "0");
-      }
-
-      cairo_restore(cr);
-      snprintf(temp_text, 32, "%0d.%03d", f_m, f_k);
-      cairo_show_text(cr, temp_text);
-      cairo_set_font_size(cr, vfl->size2);
-      snprintf(temp_text, 32, "%03d", f_h);
-      cairo_show_text(cr, temp_text);
-    }
+    vfo_elem_dial(VFO_E_VFO_B, vfl, abs(vfl->vfo_b_x), abs(vfl->vfo_b_y), "B:", col, bf,
+                  txvfo == 0 && oob, vfo[1].entered_frequency);
   }
 
   //
   // Everything that follows uses font size 1
   //
-  // cairo_set_font_size(cr, vfl->size1);
-  cairo_set_font_size(cr, 14.0);
+  // double size1 = vfl->size1;
+  double size1 = 14.0;
 
   // -----------------------------------------------------------
   //
@@ -1974,16 +2877,9 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->zoom_x != 0) {
-    cairo_move_to(cr, vfl->zoom_x, vfl->zoom_y);
-
-    if (active_receiver->zoom > 1) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
     snprintf(temp_text, 32, "Zoom %d", active_receiver->zoom);
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_ZOOM, vfl->zoom_x, vfl->zoom_y, size1,
+                  active_receiver->zoom > 1 ? col_attn : col_shade, temp_text);
   }
 
   // -----------------------------------------------------------
@@ -1992,15 +2888,7 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if ((protocol == ORIGINAL_PROTOCOL || protocol == NEW_PROTOCOL) && can_transmit && vfl->ps_x != 0) {
-    cairo_move_to(cr, vfl->ps_x, vfl->ps_y);
-
-    if (transmitter->puresignal) {
-      cairo_set_source_rgba(cr, COLOUR_OK);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    cairo_show_text(cr, "PS");
+    vfo_elem_text(VFO_E_PS, vfl->ps_x, vfl->ps_y, size1, transmitter->puresignal ? col_ok : col_shade, "PS");
   }
 
   // -----------------------------------------------------------
@@ -2009,15 +2897,8 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->rit_x != 0) {
-    if (vfo[id].rit_enabled == 0) {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    }
-
     snprintf(temp_text, 32, "RIT %lldHz", vfo[id].rit);
-    cairo_move_to(cr, vfl->rit_x, vfl->rit_y);
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_RIT, vfl->rit_x, vfl->rit_y, size1, vfo[id].rit_enabled ? col_attn : col_shade, temp_text);
   }
 
   // -----------------------------------------------------------
@@ -2026,15 +2907,9 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (can_transmit && vfl->xit_x != 0) {
-    if (vfo[txvfo].xit_enabled == 0) {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    }
-
     snprintf(temp_text, 32, "XIT %lldHz", vfo[txvfo].xit);
-    cairo_move_to(cr, vfl->xit_x, vfl->xit_y);
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_XIT, vfl->xit_x, vfl->xit_y, size1, vfo[txvfo].xit_enabled ? col_attn : col_shade,
+                  temp_text);
   }
 
   // -----------------------------------------------------------
@@ -2043,22 +2918,17 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->nb_x != 0) {
-    cairo_move_to(cr, vfl->nb_x, vfl->nb_y);
-
     switch (active_receiver->nb) {
     case 1:
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-      cairo_show_text(cr, "NB");
+      vfo_elem_text(VFO_E_NB, vfl->nb_x, vfl->nb_y, size1, col_attn, "NB");
       break;
 
     case 2:
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-      cairo_show_text(cr, "NB2");
+      vfo_elem_text(VFO_E_NB, vfl->nb_x, vfl->nb_y, size1, col_attn, "NB2");
       break;
 
     default:
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-      cairo_show_text(cr, "NB");
+      vfo_elem_text(VFO_E_NB, vfl->nb_x, vfl->nb_y, size1, col_shade, "NB");
       break;
     }
   }
@@ -2069,32 +2939,25 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->nr_x != 0) {
-    cairo_move_to(cr, vfl->nr_x, vfl->nr_y);
-
     switch (active_receiver->nr) {
     case 1:
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-      cairo_show_text(cr, "NR");
+      vfo_elem_text(VFO_E_NR, vfl->nr_x, vfl->nr_y, size1, col_attn, "NR");
       break;
 
     case 2:
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-      cairo_show_text(cr, "NR2");
+      vfo_elem_text(VFO_E_NR, vfl->nr_x, vfl->nr_y, size1, col_attn, "NR2");
       break;
 
     case 3:
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-      cairo_show_text(cr, "NR3");
+      vfo_elem_text(VFO_E_NR, vfl->nr_x, vfl->nr_y, size1, col_attn, "NR3");
       break;
 
     case 4:
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-      cairo_show_text(cr, "NR4");
+      vfo_elem_text(VFO_E_NR, vfl->nr_x, vfl->nr_y, size1, col_attn, "NR4");
       break;
 
     default:
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-      cairo_show_text(cr, "NR");
+      vfo_elem_text(VFO_E_NR, vfl->nr_x, vfl->nr_y, size1, col_shade, "NR");
       break;
     }
   }
@@ -2105,15 +2968,7 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->anf_x != 0) {
-    cairo_move_to(cr, vfl->anf_x, vfl->anf_y);
-
-    if (active_receiver->anf) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    cairo_show_text(cr, "ANF");
+    vfo_elem_text(VFO_E_ANF, vfl->anf_x, vfl->anf_y, size1, active_receiver->anf ? col_attn : col_shade, "ANF");
   }
 
   // -----------------------------------------------------------
@@ -2122,15 +2977,7 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->snb_x != 0) {
-    cairo_move_to(cr, vfl->snb_x, vfl->snb_y);
-
-    if (active_receiver->snb) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    cairo_show_text(cr, "SNB");
+    vfo_elem_text(VFO_E_SNB, vfl->snb_x, vfl->snb_y, size1, active_receiver->snb ? col_attn : col_shade, "SNB");
   }
 
   // -----------------------------------------------------------
@@ -2139,15 +2986,7 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->dexp_x != 0 && can_transmit) {
-    cairo_move_to(cr, vfl->dexp_x, vfl->dexp_y);
-
-    if (transmitter->dexp) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    cairo_show_text(cr, "DEXP");
+    vfo_elem_text(VFO_E_DEXP, vfl->dexp_x, vfl->dexp_y, size1, transmitter->dexp ? col_attn : col_shade, "DEXP");
   }
 
   // -----------------------------------------------------------
@@ -2156,32 +2995,25 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->agc_x != 0) {
-    cairo_move_to(cr, vfl->agc_x, vfl->agc_y);
-
     switch (active_receiver->agc) {
     case AGC_OFF:
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-      cairo_show_text(cr, "AGC off");
+      vfo_elem_text(VFO_E_AGC, vfl->agc_x, vfl->agc_y, size1, col_shade, "AGC off");
       break;
 
     case AGC_LONG:
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-      cairo_show_text(cr, "AGC long");
+      vfo_elem_text(VFO_E_AGC, vfl->agc_x, vfl->agc_y, size1, col_attn, "AGC long");
       break;
 
     case AGC_SLOW:
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-      cairo_show_text(cr, "AGC slow");
+      vfo_elem_text(VFO_E_AGC, vfl->agc_x, vfl->agc_y, size1, col_attn, "AGC slow");
       break;
 
     case AGC_MEDIUM:
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-      cairo_show_text(cr, "AGC med");
+      vfo_elem_text(VFO_E_AGC, vfl->agc_x, vfl->agc_y, size1, col_attn, "AGC med");
       break;
 
     case AGC_FAST:
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-      cairo_show_text(cr, "AGC fast");
+      vfo_elem_text(VFO_E_AGC, vfl->agc_x, vfl->agc_y, size1, col_attn, "AGC fast");
       break;
     }
   }
@@ -2192,29 +3024,21 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (can_transmit && vfl->cmpr_x != 0) {
-    cairo_move_to(cr, vfl->cmpr_x, vfl->cmpr_y);
-
     if (transmitter->cfc && transmitter->cfc_eq) {
       snprintf(temp_text, 32, "CFC %+d %+d", (int) transmitter->cfc_lvl[0], (int) transmitter->cfc_post[0]);
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    }
-
-    if (transmitter->cfc && !transmitter->cfc_eq) {
+      col = col_attn;
+    } else if (transmitter->cfc) {
       snprintf(temp_text, 32, "CFC PR %+d", (int) transmitter->cfc_lvl[0]);
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    }
-
-    if (!transmitter->cfc && transmitter->cfc_eq) {
+      col = col_attn;
+    } else if (transmitter->cfc_eq) {
       snprintf(temp_text, 32, "CFC PO %+d", (int) transmitter->cfc_post[0]);
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    }
-
-    if (!transmitter->cfc && !transmitter->cfc_eq) {
+      col = col_attn;
+    } else {
       snprintf(temp_text, 32, "CFC");
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
+      col = col_shade;
     }
 
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_CMPR, vfl->cmpr_x, vfl->cmpr_y, size1, col, temp_text);
   }
 
   // -----------------------------------------------------------
@@ -2223,15 +3047,8 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->eq_x != 0) {
-    cairo_move_to(cr, vfl->eq_x + 22, vfl->eq_y);
-
-    if (active_receiver->eq_enable) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-      cairo_show_text(cr, "RxEQ");
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-      cairo_show_text(cr, "RxEQ");
-    }
+    vfo_elem_text(VFO_E_RXEQ, vfl->eq_x + 22, vfl->eq_y, size1, active_receiver->eq_enable ? col_attn : col_shade,
+                  "RxEQ");
   }
 
   // -----------------------------------------------------------
@@ -2239,22 +3056,16 @@ void vfo_update(void) {
   // Draw string indicating DIVERSITY status
   //
   // -----------------------------------------------------------
-  if (vfl->div_x != 0) {
-    cairo_move_to(cr, vfl->div_x, vfl->div_y);
-
-    if (can_transmit) {
-      if (transmitter->compressor) {
-        snprintf(temp_text, 32, "PROC %+d", (int) transmitter->compressor_level);
-        cairo_set_source_rgba(cr, COLOUR_ATTN);
-      }
-
-      if (!transmitter->compressor) {
-        snprintf(temp_text, 32, "PROC");
-        cairo_set_source_rgba(cr, COLOUR_SHADE);
-      }
-
-      cairo_show_text(cr, temp_text);
+  if (vfl->div_x != 0 && can_transmit) {
+    if (transmitter->compressor) {
+      snprintf(temp_text, 32, "PROC %+d", (int) transmitter->compressor_level);
+      col = col_attn;
+    } else {
+      snprintf(temp_text, 32, "PROC");
+      col = col_shade;
     }
+
+    vfo_elem_text(VFO_E_PROC, vfl->div_x, vfl->div_y, size1, col, temp_text);
   }
 
   // -----------------------------------------------------------
@@ -2272,9 +3083,7 @@ void vfo_update(void) {
     if (s >= STEPS) { s = 0; }
 
     snprintf(temp_text, 32, "Step %s", step_labels[s]);
-    cairo_move_to(cr, vfl->step_x, vfl->step_y);
-    cairo_set_source_rgba(cr, COLOUR_ATTN);
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_STEP, vfl->step_x, vfl->step_y, size1, col_attn, temp_text);
   }
 
   // -----------------------------------------------------------
@@ -2283,15 +3092,7 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->ctun_x != 0) {
-    cairo_move_to(cr, vfl->ctun_x + 5, vfl->ctun_y);
-
-    if (vfo[id].ctun) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    cairo_show_text(cr, "CTUN");
+    vfo_elem_text(VFO_E_CTUN, vfl->ctun_x + 5, vfl->ctun_y, size1, vfo[id].ctun ? col_attn : col_shade, "CTUN");
   }
 
   // -----------------------------------------------------------
@@ -2300,15 +3101,7 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->cat_x != 0) {
-    cairo_move_to(cr, vfl->cat_x, vfl->cat_y);
-
-    if (cat_control > 0) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    cairo_show_text(cr, "CAT");
+    vfo_elem_text(VFO_E_CAT, vfl->cat_x, vfl->cat_y, size1, cat_control > 0 ? col_attn : col_shade, "CAT");
   }
 
   // -----------------------------------------------------------
@@ -2318,24 +3111,14 @@ void vfo_update(void) {
   // -----------------------------------------------------------
 
   if (vfl->mute_x != 0) {
-    cairo_move_to(cr, vfl->mute_x, vfl->mute_y);
-
-    if (active_receiver->mute_radio) {
-      cairo_set_source_rgba(cr, COLOUR_ALARM);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    snprintf(temp_text, 32, "MUTE");
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_MUTE, vfl->mute_x, vfl->mute_y, size1, active_receiver->mute_radio ? col_alarm : col_shade,
+                  "MUTE");
   }
 
   // TX-EQ & Leveler & Tuning state
   if (can_transmit && vfl->eq_x != 0) {
-    cairo_move_to(cr, vfl->base_x + 40, vfl->base_y);
-
     if (transmitter->eq_enable) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
+      col = col_attn;
 
       if (transmitter->eq_gain[0] == 0.0) {
         snprintf(temp_text, 32, "TxEQ");
@@ -2343,102 +3126,64 @@ void vfo_update(void) {
         snprintf(temp_text, 32, "TxEQ %+d", (int) transmitter->eq_gain[0]);
       }
     } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
+      col = col_shade;
       snprintf(temp_text, 32, "TxEQ");
     }
 
-    cairo_show_text(cr, temp_text);
-    cairo_move_to(cr, vfl->base_x + 110, vfl->base_y);
+    vfo_elem_text(VFO_E_TXEQ, vfl->base_x + 40, vfl->base_y, size1, col, temp_text);
 
     if (transmitter->lev_enable) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
+      col = col_attn;
       snprintf(temp_text, 32, "LEV %+d", (int) transmitter->lev_gain);
     } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
+      col = col_shade;
       snprintf(temp_text, 32, "LEV");
     }
 
-    cairo_show_text(cr, temp_text);
-    cairo_move_to(cr, vfl->base_x + 180, vfl->base_y);
+    vfo_elem_text(VFO_E_LEV, vfl->base_x + 110, vfl->base_y, size1, col, temp_text);
 
     if (transmitter->phrot_enable) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
+      col = col_attn;
       snprintf(temp_text, 32, "PH-ROT %+d", (int) transmitter->phrot_stage);
     } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
+      col = col_shade;
       snprintf(temp_text, 32, "PH-ROT");
     }
 
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_PHROT, vfl->base_x + 180, vfl->base_y, size1, col, temp_text);
 #if defined (__AUTOG__)
 
     if (device == DEVICE_HERMES_LITE2 || device == NEW_DEVICE_HERMES_LITE2) {
-      cairo_move_to(cr, vfl->base_x + 260, vfl->base_y + 20);
-
       if (autogain_enabled && autogain_is_adjusted) {
-        cairo_set_source_rgba(cr, COLOUR_OK);
+        col = col_ok;
       } else if (autogain_enabled) {
-        cairo_set_source_rgba(cr, COLOUR_ATTN);
+        col = col_attn;
       } else {
-        cairo_set_source_rgba(cr, COLOUR_SHADE);
+        col = col_shade;
       }
 
-      if (autogain_time_enabled) {
-        snprintf(temp_text, 32, "AGT");
-      } else {
-        snprintf(temp_text, 32, "AG");
-      }
-
-      cairo_show_text(cr, temp_text);
+      vfo_elem_text(VFO_E_AG, vfl->base_x + 260, vfl->base_y + 20, size1, col, autogain_time_enabled ? "AGT" : "AG");
 
       if (!have_radioberry1 &&  !have_radioberry2 && !have_radioberry3) {
-        cairo_move_to(cr, vfl->base_x + 260, vfl->base_y + 35);
-
-        if (hl2_cl1_input) {
-          cairo_set_source_rgba(cr, COLOUR_OK);
-        } else {
-          cairo_set_source_rgba(cr, COLOUR_SHADE);
-        }
-
-        snprintf(temp_text, 32, "CL1");
-        cairo_show_text(cr, temp_text);
+        vfo_elem_text(VFO_E_CL1, vfl->base_x + 260, vfl->base_y + 35, size1, hl2_cl1_input ? col_ok : col_shade, "CL1");
       }
     }
 
 #endif
 #if defined (__HAVEATU__)
-    cairo_move_to(cr, vfl->base_x + 260, vfl->base_y + 50);
-
-    if (active_receiver->panadapter_autoscale_enabled) {
-      cairo_set_source_rgba(cr, COLOUR_OK);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    snprintf(temp_text, 32, "NFA");
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_NFA, vfl->base_x + 260, vfl->base_y + 50, size1,
+                  active_receiver->panadapter_autoscale_enabled ? col_ok : col_shade, "NFA");
 
     if (vfl->tuned_x != 0) {
-      cairo_move_to(cr, vfl->tuned_x, vfl->tuned_y);
-
-      if (transmitter->is_tuned) {
-        cairo_set_source_rgba(cr, COLOUR_OK);
-        snprintf(temp_text, 32, "TUNED");
-      } else {
-        cairo_set_source_rgba(cr, COLOUR_ALARM);
-        snprintf(temp_text, 32, "TUNED");
-      }
-
-      cairo_show_text(cr, temp_text);
+      vfo_elem_text(VFO_E_TUNED, vfl->tuned_x, vfl->tuned_y, size1, transmitter->is_tuned ? col_ok : col_alarm,
+                    "TUNED");
     }
 
 #endif
 
     if (vfl->preamp_x != 0) {
-      cairo_move_to(cr, vfl->preamp_x, vfl->preamp_y);
-
       if (transmitter->addgain_enable) {
-        cairo_set_source_rgba(cr, COLOUR_ATTN);
+        col = col_attn;
 
         if (transmitter->addgain_gain > 0) {
           snprintf(temp_text, 32, "Mic PreAmp +%.0fdb", transmitter->addgain_gain);
@@ -2446,11 +3191,11 @@ void vfo_update(void) {
           snprintf(temp_text, 32, "Mic PreAmp");
         }
       } else {
-        cairo_set_source_rgba(cr, COLOUR_SHADE);
+        col = col_shade;
         snprintf(temp_text, 32, "Mic PreAmp");
       }
 
-      cairo_show_text(cr, temp_text);
+      vfo_elem_text(VFO_E_PREAMP, vfl->preamp_x, vfl->preamp_y, size1, col, temp_text);
     }
   }
 
@@ -2460,15 +3205,7 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (can_transmit && vfl->vox_x != 0) {
-    cairo_move_to(cr, vfl->vox_x, vfl->vox_y);
-
-    if (vox_enabled) {
-      cairo_set_source_rgba(cr, COLOUR_OK);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    cairo_show_text(cr, "VOX");
+    vfo_elem_text(VFO_E_VOX, vfl->vox_x, vfl->vox_y, size1, vox_enabled ? col_ok : col_shade, "VOX");
   }
 
   // -----------------------------------------------------------
@@ -2477,15 +3214,7 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->lock_x != 0) {
-    cairo_move_to(cr, vfl->lock_x, vfl->lock_y);
-
-    if (locked) {
-      cairo_set_source_rgba(cr, COLOUR_ALARM);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    cairo_show_text(cr, "Locked");
+    vfo_elem_text(VFO_E_LOCK, vfl->lock_x, vfl->lock_y, size1, locked ? col_alarm : col_shade, "Locked");
   }
 
   // -----------------------------------------------------------
@@ -2494,31 +3223,13 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (can_transmit && vfl->mgain_x != 0) {
-    cairo_move_to(cr, vfl->mgain_x, vfl->mgain_y);
-    cairo_set_source_rgba(cr, COLOUR_ATTN);
     snprintf(temp_text, 32, "MicG %+d", (int)transmitter->mic_gain);
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_MGAIN, vfl->mgain_x, vfl->mgain_y, size1, col_attn, temp_text);
   }
 
   if (can_transmit && device == DEVICE_HERMES_LITE2) {
-    cairo_move_to(cr, vfl->split_x, 59);
-
-    if (enable_hl2_atu_gateware) {
-      cairo_set_source_rgba(cr, COLOUR_OK);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    cairo_show_text(cr, "ATU");
-    cairo_move_to(cr, vfl->dexp_x, 59);
-
-    if (pa_enabled) {
-      cairo_set_source_rgba(cr, COLOUR_OK);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    cairo_show_text(cr, "PA");
+    vfo_elem_text(VFO_E_ATU, vfl->split_x, 59, size1, enable_hl2_atu_gateware ? col_ok : col_shade, "ATU");
+    vfo_elem_text(VFO_E_PA, vfl->dexp_x, 59, size1, pa_enabled ? col_ok : col_shade, "PA");
   }
 
   // -----------------------------------------------------------
@@ -2527,15 +3238,7 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->split_x != 0) {
-    cairo_move_to(cr, vfl->split_x, vfl->split_y);
-
-    if (split) {
-      cairo_set_source_rgba(cr, COLOUR_OK);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    cairo_show_text(cr, "Split");
+    vfo_elem_text(VFO_E_SPLIT, vfl->split_x, vfl->split_y, size1, split ? col_ok : col_shade, "Split");
   }
 
   // -----------------------------------------------------------
@@ -2544,19 +3247,8 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (vfl->sat_x != 0) {
-    cairo_move_to(cr, vfl->sat_x, vfl->sat_y);
-
-    if (sat_mode != SAT_NONE) {
-      cairo_set_source_rgba(cr, COLOUR_OK);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
-
-    if (sat_mode == SAT_NONE || sat_mode == SAT_MODE) {
-      cairo_show_text(cr, "SAT");
-    } else {
-      cairo_show_text(cr, "RSAT");
-    }
+    vfo_elem_text(VFO_E_SAT, vfl->sat_x, vfl->sat_y, size1, sat_mode != SAT_NONE ? col_ok : col_shade,
+                  (sat_mode == SAT_NONE || sat_mode == SAT_MODE) ? "SAT" : "RSAT");
   }
 
   // -----------------------------------------------------------
@@ -2565,27 +3257,15 @@ void vfo_update(void) {
   //
   // -----------------------------------------------------------
   if (can_transmit && vfl->dup_x != 0) {
-    if (duplex) {
-      cairo_set_source_rgba(cr, COLOUR_OK);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
-    }
+    vfo_elem_text(VFO_E_DUP, vfl->dup_x, vfl->dup_y, size1, duplex ? col_ok : col_shade, "DUP");
 
-    snprintf(temp_text, 32, "DUP");
-    cairo_move_to(cr, vfl->dup_x, vfl->dup_y);
-    cairo_show_text(cr, temp_text);
-  }
-
-  if (can_transmit && vfl->dup_x != 0) {
     if (transmitter->compressor && transmitter->cessb_enable && transmitter->compressor_level > 0) {
-      cairo_set_source_rgba(cr, COLOUR_OK);
+      col = col_ok;
     } else {
-      cairo_set_source_rgba(cr, COLOUR_SHADE);
+      col = col_shade;
     }
 
-    snprintf(temp_text, 32, "CESSB");
-    cairo_move_to(cr, vfl->dup_x + 38, vfl->dup_y + 15);
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_CESSB, vfl->dup_x + 38, vfl->dup_y + 15, size1, col, "CESSB");
   }
 
   // -----------------------------------------------------------
@@ -2596,19 +3276,56 @@ void vfo_update(void) {
   int multi = GetMultifunctionStatus();
 
   if (vfl->multifn_x != 0 && multi != 0) {
-    if (multi == 1) {
-      cairo_set_source_rgba(cr, COLOUR_ATTN);
-    } else {
-      cairo_set_source_rgba(cr, COLOUR_ALARM);
-    }
-
     GetMultifunctionString(temp_text, 32);
-    cairo_move_to(cr, vfl->multifn_x, vfl->multifn_y);
-    cairo_show_text(cr, temp_text);
+    vfo_elem_text(VFO_E_MULTIFN, vfl->multifn_x, vfl->multifn_y, size1, multi == 1 ? col_attn : col_alarm,
+                  temp_text);
   }
 
-  cairo_destroy (cr);
-  gtk_widget_queue_draw (vfo_panel);
+  //
+  // Hand over to the render thread
+  //
+  vfo_render_submit();
+  P2TRACE_END("vfo_render");
+}
+
+static gboolean vfo_render_timeout(gpointer data) {
+  vfo_render_timer = 0;
+  vfo_render();
+  return G_SOURCE_REMOVE;
+}
+
+//
+// vfo_update() is called (via ext_vfo_update) whenever something shown
+// in the VFO bar has changed, and when tuning with a fast encoder this
+// can be many hundred times per second. The VFO bar is re-drawn at most
+// vfo_fps times per second: if the last re-draw is less than a frame
+// period ago, a timer is started that re-draws the bar at the end of
+// the period, using the state at that time. Further calls until then
+// are no-ops.
+//
+// Only the re-draw is deferred: the VFO state is published right away
+// (vfo_publish), so the next HighPrio packet, whether scheduled or
+// periodic, uses the new state even if the bar is re-drawn later.
+//
+void vfo_update(void) {
+  gint64 now, period;
+  vfo_publish();
+
+  if (vfo_render_timer) { return; }
+
+  if (vfo_fps < 10) { vfo_fps = 10; }
+
+  if (vfo_fps > 120) { vfo_fps = 120; }
+
+  now = g_get_monotonic_time();
+  period = 1000000 / vfo_fps;
+
+  if (now - vfo_last_render >= period) {
+    vfo_render();
+  } else {
+    P2TRACE_INSTANT("vfo_update deferred", 0);
+    vfo_render_timer = g_timeout_add((guint)((period - (now - vfo_last_render) + 999) / 1000), vfo_render_timeout, NULL);
+  }
 }
 
 // cppcheck-suppress constParameterCallback
@@ -2621,12 +3338,12 @@ static gboolean vfo_press_event_cb (GtkWidget *widget, GdkEventButton *event, gp
 
     if (event->x >= abs(vfo_layout_list[vfo_layout].vfo_b_x)) { v = VFO_B; }
 
-    g_idle_add(ext_start_vfo, GINT_TO_POINTER(v));
+    P2TRACE_IDLE_ADD(ext_start_vfo, GINT_TO_POINTER(v));
     break;
 
   case GDK_BUTTON_SECONDARY:
     // do not discriminate between A and B
-    g_idle_add(ext_start_band, NULL);
+    P2TRACE_IDLE_ADD(ext_start_band, NULL);
     break;
   }
 
@@ -2692,14 +3409,14 @@ void vfo_xit_value(long long value ) {
   vfo[id].xit = value;
   vfo[id].xit_enabled = value ? 1 : 0;
   schedule_high_priority();
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 void vfo_xit_toggle(void) {
   int id = vfo_get_tx_vfo();
   TOGGLE(vfo[id].xit_enabled);
   schedule_high_priority();
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 void vfo_rit_toggle(int id) {
@@ -2709,7 +3426,7 @@ void vfo_rit_toggle(int id) {
     rx_frequency_changed(receiver[id]);
   }
 
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 void vfo_rit_value(int id, long long value) {
@@ -2720,7 +3437,7 @@ void vfo_rit_value(int id, long long value) {
     rx_frequency_changed(receiver[id]);
   }
 
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 void vfo_rit_onoff(int id, int enable) {
@@ -2730,14 +3447,14 @@ void vfo_rit_onoff(int id, int enable) {
     rx_frequency_changed(receiver[id]);
   }
 
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 void vfo_xit_onoff(int enable) {
   int id = vfo_get_tx_vfo();
   vfo[id].xit_enabled = SET(enable);
   schedule_high_priority();
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 void vfo_xit_incr(int incr) {
@@ -2753,7 +3470,7 @@ void vfo_xit_incr(int incr) {
   vfo[id].xit = value;
   vfo[id].xit_enabled = (value != 0);
   schedule_high_priority();
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 void vfo_rit_incr(int id, int incr) {
@@ -2772,7 +3489,45 @@ void vfo_rit_incr(int id, int incr) {
     rx_frequency_changed(receiver[id]);
   }
 
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
+}
+
+//
+// Fast re-tuning, used by the scanner.
+// The new frequency is set without rounding, SAT-mode partner
+// updates, or bandstack handling (the band is adjusted, but this
+// is a quick return as long as we stay within the band).
+// With CTUN, only the CTUN frequency (and thus the WDSP shift)
+// changes as long as the new frequency is within the current
+// span. Otherwise only the DDC frequency changes.
+//
+void vfo_id_fast_retune(int id, long long f) {
+  if (locked) { return; }
+
+  if (vfo[id].ctun) {
+    long long half = (id < receivers) ? (long long) receiver[id]->sample_rate / 2LL : 0LL;
+
+    if (llabs(f - vfo[id].frequency) < half - 10000LL) {
+      vfo[id].ctun_frequency = f;
+      vfo[id].offset = f - vfo[id].frequency;
+    } else {
+      vfo[id].frequency = f;
+      vfo[id].ctun_frequency = f;
+      vfo[id].offset = 0;
+    }
+  } else {
+    vfo[id].frequency = f;
+  }
+
+  vfo_adjust_band(id, f);
+
+  if (id < receivers) {
+    rx_frequency_changed(receiver[id]);
+  } else {
+    schedule_high_priority();
+  }
+
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 //
@@ -2822,7 +3577,7 @@ void vfo_set_frequency(int v, long long f) {
     }
   }
 
-  g_idle_add(ext_vfo_update, NULL);
+  P2TRACE_IDLE_ADD(ext_vfo_update, NULL);
 }
 
 //
@@ -0,0 +1,187 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Per-CPU cache of the WDSP (FFTW) wisdom file
+//
+// FFTW wisdom contains the plans measured to be fastest on the machine
+// where it was created. Re-used on a different CPU (e.g. after moving
+// the SD card from a RPi4 to a RPi5), the plans are still accepted but
+// may be far from optimal. Likewise, a new WDSP version may come with
+// a different FFTW build.
+//
+// Therefore the wisdom file is not kept in the working directory but
+// in wisdom/<key>/, where the key is made of the CPU model and the
+// WDSP version. A different CPU or WDSP version gets a new directory,
+// hence a new wisdom file, while the one for the previous machine is
+// kept should the card be moved back.
+//
+// Older versions kept the wisdom file in the working directory, as
+// wdspWisdom00 or wdspWisdom depending on the WDSP version. It is
+// copied (under its own name) into the new directory once, for the
+// first key that finds no wisdom file of its own: this is (most likely) the machine on which
+// the old file was created. The key is recorded in wisdom/legacy, so
+// that a different CPU or WDSP version does not import it again. The
+// old file is left in place for older versions.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <gtk/gtk.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+#ifdef __APPLE__
+  #include <sys/sysctl.h>
+#endif
+
+#include <wdsp.h>
+
+#include "wisdomcache.h"
+#include "message.h"
+
+//
+// Depending on the WDSP version, the wisdom file is called
+// wdspWisdom00 or wdspWisdom
+//
+static const char *wisdom_files[] = { "wdspWisdom00", "wdspWisdom" };
+
+static void wisdom_cpu_model(char *model, size_t len) {
+  struct utsname un;
+  model[0] = 0;
+#ifdef __APPLE__
+  size_t size = len;
+
+  if (sysctlbyname("machdep.cpu.brand_string", model, &size, NULL, 0) != 0) { model[0] = 0; }
+
+#else
+  //
+  // Raspberry Pi kernels report the board in "Model", x86 kernels
+  // report the CPU in "model name". Prefer the former.
+  //
+  FILE *fp = fopen("/proc/cpuinfo", "r");
+  char line[256];
+  int prio = 0;
+
+  if (fp) {
+    while (fgets(line, sizeof(line), fp)) {
+      char *colon = strchr(line, ':');
+      int p = 0;
+
+      if (colon == NULL) { continue; }
+
+      if (!strncmp(line, "Model", 5) && (line[5] == ' ' || line[5] == '\t')) {
+        p = 3;
+      } else if (!strncmp(line, "model name", 10)) {
+        p = 2;
+      } else if (!strncmp(line, "CPU part", 8)) {
+        p = 1;
+      }
+
+      if (p > prio) {
+        prio = p;
+        g_strlcpy(model, g_strstrip(colon + 1), len);
+      }
+    }
+
+    fclose(fp);
+  }
+
+#endif
+
+  if (model[0] == 0 && uname(&un) == 0) {
+    g_strlcpy(model, un.machine, len);
+  }
+}
+
+static int wisdom_copy(const char *from, const char *to) {
+  char *contents = NULL;
+  gsize len;
+  int rc = g_file_get_contents(from, &contents, &len, NULL) && g_file_set_contents(to, contents, len, NULL);
+  g_free(contents);
+  return rc;
+}
+
+static void wisdom_import_legacy(const char *cwd, const char *dir, const char *key) {
+  char *owner = g_strdup_printf("%s/wisdom/legacy", cwd);
+  char *owner_key = NULL;
+  int imported = 0;
+
+  //
+  // Only the first key gets the old file
+  //
+  if (g_file_get_contents(owner, &owner_key, NULL, NULL) && strcmp(g_strstrip(owner_key), key) != 0) { goto out; }
+
+  for (int i = 0; i < (int)(sizeof(wisdom_files) / sizeof(wisdom_files[0])); i++) {
+    char *legacy = g_strdup_printf("%s/%s", cwd, wisdom_files[i]);
+    char *target = g_strdup_printf("%s%s", dir, wisdom_files[i]);
+
+    if (!g_file_test(target, G_FILE_TEST_EXISTS) && g_file_test(legacy, G_FILE_TEST_IS_REGULAR)) {
+      if (wisdom_copy(legacy, target)) {
+        t_print("%s: imported %s\n", __func__, legacy);
+        imported = 1;
+      } else {
+        t_print("%s: cannot copy %s to %s\n", __func__, legacy, target);
+      }
+    }
+
+    g_free(target);
+    g_free(legacy);
+  }
+
+  if (imported) { g_file_set_contents(owner, key, -1, NULL); }
+
+out:
+  g_free(owner_key);
+  g_free(owner);
+}
+
+char *wisdom_cache_dir(void) {
+  char model[128];
+  char key[128];
+  char cwd[1024];
+  char *dir;
+  int n = 0;
+  wisdom_cpu_model(model, sizeof(model));
+
+  //
+  // Make the key a harmless file name
+  //
+  for (const char *p = model; *p && n < 80; p++) {
+    key[n++] = g_ascii_isalnum(*p) || *p == '-' || *p == '.' ? *p : '_';
+  }
+
+  snprintf(key + n, sizeof(key) - n, "-wdsp%d", GetWDSPVersion());
+
+  if (getcwd(cwd, sizeof(cwd)) == NULL) { strcpy(cwd, "."); }
+
+  dir = g_strdup_printf("%s/wisdom/%s/", cwd, key);
+
+  if (g_mkdir_with_parents(dir, 0755) != 0) {
+    t_print("%s: cannot create %s, using working directory\n", __func__, dir);
+    g_free(dir);
+    dir = g_strdup_printf("%s/", cwd);
+  } else {
+    wisdom_import_legacy(cwd, dir, key);
+  }
+
+  t_print("%s: CPU=\"%s\" wisdom directory=%s\n", __func__, model, dir);
+  return dir;
+}
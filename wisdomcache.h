@@ -0,0 +1,29 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _WISDOMCACHE_H_
+#define _WISDOMCACHE_H_
+
+//
+// Returns the directory (with trailing slash) in which the WDSP
+// wisdom file for this CPU and WDSP version is kept, and creates
+// it if necessary. The string must be freed with g_free().
+//
+extern char *wisdom_cache_dir(void);
+
+#endif